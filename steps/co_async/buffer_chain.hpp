@@ -0,0 +1,233 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "task.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <span>
+#include <string>
+#include <sys/uio.h>
+
+namespace co_async {
+
+// 引用计数内存块上的一段只读视图，复制切片只增加引用计数，不复制数据
+struct BufferSlice {
+    std::shared_ptr<char[]> mBlock;
+    std::size_t mCapacity = 0; // 整个内存块的容量
+    std::size_t mOffset = 0;
+    std::size_t mSize = 0;
+
+    static BufferSlice allocate(std::size_t capacity) {
+        return {std::make_shared_for_overwrite<char[]>(capacity), capacity, 0, 0};
+    }
+
+    char const* data() const noexcept { return mBlock.get() + mOffset; }
+    std::size_t size() const noexcept { return mSize; }
+    std::span<char const> span() const noexcept { return {data(), mSize}; }
+
+    // 切片独占内存块时，其后的剩余空间可以继续追加数据
+    std::size_t tailroom() const noexcept {
+        return mBlock.use_count() == 1 ? mCapacity - mOffset - mSize : 0;
+    }
+};
+
+// 由若干切片组成的缓冲链。拼接、拆分都只搬动切片而不复制数据，
+// 可以导出为 iovec 交给 writev，适合代理、扇出等需要原样转发载荷的场景
+struct BufferChain {
+    static constexpr std::size_t kBlockSize = 4096;
+
+    BufferChain() = default;
+    BufferChain(BufferChain&&) = default;
+    BufferChain& operator=(BufferChain&&) = default;
+    BufferChain(const BufferChain&) = default; // 共享切片
+    BufferChain& operator=(const BufferChain&) = default;
+
+    std::size_t size() const noexcept { return mSize; }
+    bool empty() const noexcept { return mSize == 0; }
+    const std::deque<BufferSlice>& slices() const noexcept { return mSlices; }
+
+    void clear() noexcept {
+        mSlices.clear();
+        mSize = 0;
+    }
+
+    // 复制 data 到链尾：优先写入末尾切片的剩余空间，不够时再分配新块
+    void append(std::span<char const> data) {
+        while (!data.empty()) {
+            auto room = prepare(data.size());
+            std::size_t n = std::min(room.size(), data.size());
+            std::memcpy(room.data(), data.data(), n);
+            commit(n);
+            data = data.subspan(n);
+        }
+    }
+
+    void append(BufferSlice slice) {
+        if (slice.mSize) {
+            mSize += slice.mSize;
+            mSlices.push_back(std::move(slice));
+        }
+    }
+
+    void append(const BufferChain& chain) {
+        for (const auto& slice : chain.mSlices) {
+            append(slice);
+        }
+    }
+
+    void append(BufferChain&& chain) {
+        for (auto& slice : chain.mSlices) {
+            append(std::move(slice));
+        }
+        chain.clear();
+    }
+
+    // 在链尾准备一段至少 1 字节、至多约 hint 字节的可写空间，写入后用 commit(n) 提交
+    std::span<char> prepare(std::size_t hint = kBlockSize) {
+        if (mSlices.empty() || mSlices.back().tailroom() == 0) {
+            mSlices.push_back(BufferSlice::allocate(std::max(hint, kBlockSize)));
+        }
+        auto& tail = mSlices.back();
+        return {tail.mBlock.get() + tail.mOffset + tail.mSize, tail.tailroom()};
+    }
+
+    // 在链尾准备至少 n 字节的连续可写空间：末尾切片的剩余空间不够时另起一块，原剩余空间弃用
+    std::span<char> prepare_contiguous(std::size_t n) {
+        if (!mSlices.empty() && mSlices.back().tailroom() < n) {
+            if (mSlices.back().mSize == 0) {
+                mSlices.pop_back();
+            }
+            mSlices.push_back(BufferSlice::allocate(std::max(n, kBlockSize)));
+        }
+        return prepare(n);
+    }
+
+    void commit(std::size_t n) noexcept {
+        mSlices.back().mSize += n;
+        mSize += n;
+    }
+
+    // 从链首丢弃 n 字节
+    void consume(std::size_t n) noexcept {
+        n = std::min(n, mSize);
+        mSize -= n;
+        while (n) {
+            auto& front = mSlices.front();
+            if (n < front.mSize) {
+                front.mOffset += n;
+                front.mSize -= n;
+                break;
+            }
+            n -= front.mSize;
+            mSlices.pop_front();
+        }
+    }
+
+    // 拆出链首的 n 字节作为新链返回，跨界的切片被一分为二（共享同一内存块）
+    BufferChain split(std::size_t n) {
+        BufferChain head;
+        n = std::min(n, mSize);
+        while (n) {
+            auto& front = mSlices.front();
+            if (n < front.mSize) {
+                BufferSlice part = front;
+                part.mSize = n;
+                head.append(std::move(part));
+                consume(n);
+                break;
+            }
+            n -= front.mSize;
+            mSize -= front.mSize;
+            head.append(std::move(front));
+            mSlices.pop_front();
+        }
+        return head;
+    }
+
+    // 合并为单个连续切片（只有一个切片时不复制）
+    std::span<char const> coalesce() {
+        if (mSlices.size() > 1) {
+            BufferSlice merged = BufferSlice::allocate(mSize);
+            for (const auto& slice : mSlices) {
+                std::memcpy(merged.mBlock.get() + merged.mSize, slice.data(), slice.size());
+                merged.mSize += slice.size();
+            }
+            mSlices.clear();
+            mSlices.push_back(std::move(merged));
+        }
+        return mSlices.empty() ? std::span<char const>() : mSlices.front().span();
+    }
+
+    // 把链首的切片依次填入 out，返回填入的个数
+    std::size_t iovecs(std::span<iovec> out) const noexcept {
+        std::size_t n = std::min(out.size(), mSlices.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = {const_cast<char*>(mSlices[i].data()), mSlices[i].size()};
+        }
+        return n;
+    }
+
+    std::string to_string() const {
+        std::string s;
+        s.reserve(mSize);
+        for (const auto& slice : mSlices) {
+            s.append(slice.data(), slice.size());
+        }
+        return s;
+    }
+
+  private:
+    std::deque<BufferSlice> mSlices;
+    std::size_t mSize = 0;
+};
+
+// 用 writev 把整条链写出，写出的部分随即从链上移除
+inline Task<std::size_t> writev_file(EpollLoop& loop, AsyncFile& file, BufferChain& chain) {
+    std::size_t total = 0;
+    while (!chain.empty()) {
+        iovec iov[64];
+        std::size_t n = chain.iovecs(iov);
+        co_await wait_file_event(loop, file, EPOLLOUT | EPOLLHUP);
+        auto len = checkErrorNonBlock(writev(file.fileNo(), iov, n));
+        chain.consume(len);
+        total += len;
+    }
+    co_return total;
+}
+
+// 读取数据直接追加到链尾，返回读到的字节数（0 表示 EOF）
+inline Task<std::size_t> read_file(EpollLoop& loop, AsyncFile& file, BufferChain& chain) {
+    auto len = co_await read_file(loop, file, chain.prepare());
+    chain.commit(len);
+    co_return len;
+}
+
+// 让 IStream/OStream 以缓冲链为数据源/目的地：读取时从链首取走数据，写入时追加到链尾
+struct ChainBuf {
+    BufferChain mChain;
+
+    ChainBuf() noexcept {}
+    ChainBuf(BufferChain chain) : mChain(std::move(chain)) {}
+
+    Task<std::size_t> read(std::span<char> buffer) {
+        std::size_t total = 0;
+        while (total < buffer.size() && !mChain.empty()) {
+            auto front = mChain.slices().front().span();
+            std::size_t n = std::min(front.size(), buffer.size() - total);
+            std::memcpy(buffer.data() + total, front.data(), n);
+            mChain.consume(n);
+            total += n;
+        }
+        co_return total;
+    }
+
+    Task<std::size_t> write(std::span<const char> buffer) {
+        mChain.append(buffer);
+        co_return buffer.size();
+    }
+};
+
+} // namespace co_async
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <unordered_map>
+#include <utility>
+
+namespace co_async {
+
+// 按 2 的幂划分尺寸档位的 slab 缓冲池：每档从整块 slab 中切出等长缓冲区，
+// 归还的缓冲区挂回所属 slab 的侵入式空闲链表，申请与归还都是 O(1)，平时不触发系统分配器。
+// slab 整块空闲后直接 munmap 还给系统，每档只留一块备用，流量高峰过后内存随之回落。
+// 超过最大档位的请求直接走 new/delete。
+// 池必须比从它申请的所有缓冲区活得更久；池不能跨线程共享
+struct BufferPool {
+    static constexpr std::size_t kMinShift = 9;  // 512 B
+    static constexpr std::size_t kMaxShift = 16; // 64 KiB
+    static constexpr std::size_t kSlabSize = std::size_t(1) << 18;
+    static constexpr std::size_t kSpareSlabs = 1; // 每档保留的整块空闲 slab 数，避免在边界上反复映射
+
+    BufferPool() = default;
+    BufferPool(BufferPool&&) = delete;
+    ~BufferPool() {
+        for (auto& [base, slab] : mSlabs) {
+            unmapSlab(base);
+        }
+    }
+
+    static constexpr std::size_t classSize(std::size_t size) noexcept {
+        return size <= (std::size_t(1) << kMinShift) ? std::size_t(1) << kMinShift : std::bit_ceil(size);
+    }
+
+    // 返回至少 size 字节的缓冲区，实际容量为 classSize(size)
+    char* acquire(std::size_t size) {
+        std::size_t shift = std::countr_zero(classSize(size));
+        if (shift > kMaxShift) [[unlikely]] {
+            return new char[classSize(size)];
+        }
+        std::size_t index = shift - kMinShift;
+        if (!mAvailable[index]) [[unlikely]] {
+            refill(shift);
+        }
+        Slab* slab = mAvailable[index];
+        FreeNode* node = slab->mFree;
+        slab->mFree = node->mNext;
+        if (slab->mUsed++ == 0) {
+            --mEmpty[index];
+        }
+        if (!slab->mFree) {
+            unlink(slab);
+        }
+        return reinterpret_cast<char*>(node);
+    }
+
+    void release(char* buffer, std::size_t size) noexcept {
+        std::size_t shift = std::countr_zero(classSize(size));
+        if (shift > kMaxShift) [[unlikely]] {
+            delete[] buffer;
+            return;
+        }
+        std::size_t index = shift - kMinShift;
+        auto base = reinterpret_cast<std::uintptr_t>(buffer) & ~(kSlabSize - 1);
+        Slab* slab = &mSlabs.find(base)->second;
+        if (!slab->mFree) {
+            link(slab);
+        }
+        slab->mFree = new (buffer) FreeNode{slab->mFree};
+        if (--slab->mUsed == 0) {
+            if (mEmpty[index] == kSpareSlabs) {
+                unlink(slab);
+                mSlabs.erase(base);
+                unmapSlab(base);
+            } else {
+                ++mEmpty[index];
+            }
+        }
+    }
+
+    // 当前映射着的 slab 数
+    std::size_t slab_count() const noexcept { return mSlabs.size(); }
+
+    // 线程局部池：在线程退出时析构，此前须归还其中的全部缓冲区，
+    // 因此静态对象或跨线程传递的对象不应持有从它申请的缓冲区
+    static BufferPool& local() {
+        thread_local BufferPool pool;
+        return pool;
+    }
+
+  private:
+    struct FreeNode {
+        FreeNode* mNext;
+    };
+
+    // slab 的元数据不放在 slab 内，免得最大档位的 slab 为此少切一块
+    struct Slab {
+        FreeNode* mFree = nullptr;
+        std::size_t mUsed = 0;
+        std::size_t mIndex;
+        Slab* mPrev = nullptr; // 本档尚有空闲缓冲区的 slab 链表
+        Slab* mNext = nullptr;
+    };
+
+    void refill(std::size_t shift) {
+        std::size_t size = std::size_t(1) << shift;
+        char* base = mapSlab();
+        auto& slab = mSlabs[reinterpret_cast<std::uintptr_t>(base)];
+        slab.mIndex = shift - kMinShift;
+        for (std::size_t off = kSlabSize; off != 0; off -= size) {
+            slab.mFree = new (base + off - size) FreeNode{slab.mFree};
+        }
+        link(&slab);
+        ++mEmpty[slab.mIndex];
+    }
+
+    void link(Slab* slab) noexcept {
+        Slab*& head = mAvailable[slab->mIndex];
+        slab->mPrev = nullptr;
+        slab->mNext = head;
+        if (head) {
+            head->mPrev = slab;
+        }
+        head = slab;
+    }
+
+    void unlink(Slab* slab) noexcept {
+        (slab->mPrev ? slab->mPrev->mNext : mAvailable[slab->mIndex]) = slab->mNext;
+        if (slab->mNext) {
+            slab->mNext->mPrev = slab->mPrev;
+        }
+    }
+
+    // 按 kSlabSize 对齐映射，归还时由缓冲区地址直接求出所属 slab
+    static char* mapSlab() {
+        void* p = mmap(nullptr, kSlabSize * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) [[unlikely]] {
+            throw std::bad_alloc();
+        }
+        auto addr = reinterpret_cast<std::uintptr_t>(p);
+        auto base = (addr + kSlabSize - 1) & ~(kSlabSize - 1);
+        if (base != addr) {
+            munmap(p, base - addr);
+        }
+        if (auto tail = addr + kSlabSize - base) {
+            munmap(reinterpret_cast<void*>(base + kSlabSize), tail);
+        }
+        return reinterpret_cast<char*>(base);
+    }
+
+    static void unmapSlab(std::uintptr_t base) noexcept {
+        munmap(reinterpret_cast<void*>(base), kSlabSize);
+    }
+
+    Slab* mAvailable[kMaxShift - kMinShift + 1]{};
+    std::size_t mEmpty[kMaxShift - kMinShift + 1]{};
+    std::unordered_map<std::uintptr_t, Slab> mSlabs;
+};
+
+// 惰性申请的池化缓冲区：构造时只记录容量，真正需要时才从池中取出，用完即可归还。
+// 申请后记住来源池，析构或 release() 时归还给它，因此持有缓冲区期间来源池必须存活
+struct PooledBuffer {
+    static constexpr bool kMirrored = false;
+    static constexpr std::size_t kDefaultSize = 8192;
+
+    explicit PooledBuffer(std::size_t size = kDefaultSize) noexcept : mSize(BufferPool::classSize(size)) {}
+    PooledBuffer(PooledBuffer&& that) noexcept
+        : mData(std::exchange(that.mData, nullptr)),
+          mSize(that.mSize),
+          mPool(that.mPool) {}
+    PooledBuffer& operator=(PooledBuffer&& that) noexcept {
+        std::swap(mData, that.mData);
+        std::swap(mSize, that.mSize);
+        std::swap(mPool, that.mPool);
+        return *this;
+    }
+    ~PooledBuffer() { release(); }
+
+    char* data() const noexcept { return mData; }
+    std::size_t size() const noexcept { return mSize; }
+    bool allocated() const noexcept { return mData != nullptr; }
+    char& operator[](std::size_t i) const noexcept { return mData[i]; }
+
+    void acquire(BufferPool& pool) {
+        if (!mData) {
+            mData = pool.acquire(mSize);
+            mPool = &pool;
+        }
+    }
+
+    void release() noexcept {
+        if (mData) {
+            mPool->release(std::exchange(mData, nullptr), mSize);
+        }
+    }
+
+    // 换到 size 所在的容量档位；已申请时换用新档位的一块，并保留开头的 keep 字节
+    void resize(std::size_t size, std::size_t keep = 0) {
+        size = BufferPool::classSize(size);
+        if (size == mSize) {
+            return;
+        }
+        if (mData) {
+            char* data = mPool->acquire(size);
+            std::memcpy(data, mData, std::min(keep, size));
+            mPool->release(mData, mSize);
+            mData = data;
+        }
+        mSize = size;
+    }
+
+  private:
+    char* mData = nullptr;
+    std::size_t mSize;
+    BufferPool* mPool = nullptr;
+};
+
+} // namespace co_async
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "async_loop.hpp"
+#include "return_previous.hpp"
+#include "socket.hpp"
+#include "wait_queue.hpp"
+#include "when_any.hpp"
+
+#include <chrono>
+#include <span>
+#include <vector>
+
+namespace co_async {
+
+// Happy Eyeballs (RFC 8305)：多个地址交错发起连接，先建立的胜出，其余全部取消。
+// 下一个尝试在上一个发起 delay 之后开始；有尝试失败（如 ECONNREFUSED）时立即开始，不必等满 delay
+
+struct ConnectAnyCtlBlock {
+    std::size_t mPending;
+    std::coroutine_handle<> mPrevious{};
+    std::exception_ptr mException{};
+    AsyncFile mSocket;
+    std::size_t mStarted = 0;            // 已发起的尝试数
+    std::size_t mFailed = 0;             // 已失败的尝试数
+    WaitQueue mAttemptStarted;           // 等待前一个尝试发起的后续尝试
+    std::coroutine_handle<> mWaiting{};  // 正在等 delay 或失败信号的下一个尝试
+
+    bool done() const noexcept { return mSocket.fileNo() != -1 || mPending == 0; }
+};
+
+// 等待某个尝试失败。失败的尝试结束时经对称转移恢复这里，而不是在自己的帧内嵌套恢复，
+// 这样新尝试即使立即连接成功、调用者随之销毁全部尝试，也不会销毁仍在栈上的帧
+struct ConnectAnyFailureAwaiter {
+    ConnectAnyCtlBlock& mControl;
+    std::coroutine_handle<> mCoroutine{};
+
+    explicit ConnectAnyFailureAwaiter(ConnectAnyCtlBlock& ctl) noexcept : mControl(ctl) {}
+    ConnectAnyFailureAwaiter(ConnectAnyFailureAwaiter&&) = delete;
+    ~ConnectAnyFailureAwaiter() {
+        // 先等到了 delay，本协程被 when_any 销毁
+        if (mCoroutine && mControl.mWaiting == mCoroutine) {
+            mControl.mWaiting = nullptr;
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+        mCoroutine = coroutine;
+        mControl.mWaiting = coroutine;
+    }
+    void await_resume() const noexcept {}
+};
+
+inline Task<> connectAnyWaitFailure(ConnectAnyCtlBlock& ctl) {
+    co_await ConnectAnyFailureAwaiter(ctl);
+}
+
+struct ConnectAnyAwaiter {
+    ConnectAnyCtlBlock& mControl;
+    std::span<ReturnPreviousTask const> mTasks;
+    explicit ConnectAnyAwaiter(ConnectAnyCtlBlock& ctl, std::span<ReturnPreviousTask const> ts)
+        : mControl(ctl),
+          mTasks(ts) {}
+
+    bool await_ready() const noexcept { return false; }
+    // 与 WhenAnyAwaiter 不同，启动期间 mPrevious 为空，
+    // 同步完成（如连接本机立即成功或被拒绝）的尝试不会提前恢复调用者
+    bool await_suspend(std::coroutine_handle<> coroutine) const {
+        for (const auto& t : mTasks) {
+            if (mControl.done())
+                break;
+            t.mHandle.resume();
+        }
+        if (mControl.done())
+            return false;
+        mControl.mPrevious = coroutine;
+        return true;
+    }
+
+    AsyncFile await_resume() const {
+        if (mControl.mSocket.fileNo() == -1) [[unlikely]] {
+            std::rethrow_exception(mControl.mException);
+        }
+        return std::move(mControl.mSocket);
+    }
+};
+
+// 第 index 个尝试：等前一个尝试发起，再等 delay 或任一尝试失败（已发起的都已失败时不等），然后连接
+inline ReturnPreviousTask connectAnyHelper(TimerLoop& timerLoop,
+                                           EpollLoop& epollLoop,
+                                           const SocketAddress& addr,
+                                           std::size_t index,
+                                           std::chrono::system_clock::duration delay,
+                                           ConnectAnyCtlBlock& ctl) {
+    try {
+        while (ctl.mStarted < index) {
+            co_await ctl.mAttemptStarted.wait();
+        }
+        if (ctl.mFailed < ctl.mStarted) {
+            (void)co_await when_any(sleep_for(timerLoop, delay), connectAnyWaitFailure(ctl));
+        }
+        ++ctl.mStarted;
+        ctl.mAttemptStarted.notify_all(); // 下一个尝试开始计时，它随即挂起等待
+        ctl.mSocket = co_await create_tcp_client(epollLoop, addr);
+        co_return ctl.mPrevious;
+    } catch (...) {
+        ctl.mException = std::current_exception();
+    }
+    ++ctl.mFailed;
+    // 只有全部尝试都失败时才唤醒调用者，抛出最后一个错误；否则让正在等待的下一个尝试立即开始
+    if (--ctl.mPending == 0) {
+        co_return ctl.mPrevious;
+    }
+    if (auto next = std::exchange(ctl.mWaiting, nullptr)) {
+        co_return next;
+    }
+    co_return std::noop_coroutine();
+}
+
+// 按 RFC 8305 第 4 节交错排列地址族：保持首选地址族在前，两族轮流出现
+inline std::vector<SocketAddress> interleaveAddressFamilies(std::span<IpAddress const> ips, int port) {
+    std::vector<SocketAddress> first, second;
+    for (const auto& ip : ips) {
+        (ip.mAddr.index() == ips.front().mAddr.index() ? first : second).push_back(socket_address(ip, port));
+    }
+    std::vector<SocketAddress> addrs;
+    addrs.reserve(ips.size());
+    for (std::size_t i = 0; i < first.size() || i < second.size(); ++i) {
+        if (i < first.size())
+            addrs.push_back(first[i]);
+        if (i < second.size())
+            addrs.push_back(second[i]);
+    }
+    return addrs;
+}
+
+// 各地址依次间隔 delay 发起连接（前一个失败时立即发起下一个），返回最先建立的连接，
+// 其余尝试随之销毁（关闭套接字、注销监听）
+inline Task<AsyncFile> connect_any(AsyncLoop& loop,
+                                   std::vector<SocketAddress> addrs,
+                                   std::chrono::milliseconds delay = std::chrono::milliseconds(250)) {
+    if (addrs.empty()) [[unlikely]] {
+        throw std::invalid_argument("no address to connect");
+    }
+    ConnectAnyCtlBlock ctl{addrs.size()};
+    std::vector<ReturnPreviousTask> taskArray;
+    taskArray.reserve(addrs.size());
+    for (std::size_t i = 0; i < addrs.size(); ++i) {
+        taskArray.push_back(connectAnyHelper(loop, loop, addrs[i], i, delay, ctl));
+    }
+    co_return co_await ConnectAnyAwaiter(ctl, taskArray);
+}
+
+inline Task<AsyncFile> connect_any(AsyncLoop& loop,
+                                   const char* host,
+                                   int port,
+                                   std::chrono::milliseconds delay = std::chrono::milliseconds(250)) {
+    auto ips = ip_addresses(host);
+    co_return co_await connect_any(loop, interleaveAddressFamilies(ips, port), delay);
+}
+
+} // namespace co_async
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#endif
+
+namespace co_async {
+
+// CRC32C（Castagnoli 多项式，反射形式 0x82F63B78），用于日志、帧等的校验和
+inline constexpr std::array<std::uint32_t, 256> kCrc32cTable = [] {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t crc = i;
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+// 查表实现，处理的是取反后的中间值
+inline std::uint32_t crc32cSoftware(std::span<char const> data, std::uint32_t crc) noexcept {
+    for (char c : data) {
+        crc = (crc >> 8) ^ kCrc32cTable[(crc ^ static_cast<unsigned char>(c)) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SSE4.2 的 crc32 指令正是 CRC32C，每次处理 8 字节；编译时不要求 -msse4.2，运行时检测到才调用
+__attribute__((target("sse4.2"))) inline std::uint32_t crc32cHardware(std::span<char const> data,
+                                                                      std::uint32_t crc) noexcept {
+    char const* p = data.data();
+    std::size_t n = data.size();
+#if defined(__x86_64__)
+    std::uint64_t crc64 = crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<std::uint32_t>(crc64);
+#endif
+    for (; n; --n, ++p) {
+        crc = _mm_crc32_u8(crc, static_cast<unsigned char>(*p));
+    }
+    return crc;
+}
+
+inline bool crc32cHasHardware() noexcept {
+    static bool const has = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2") != 0;
+    }();
+    return has;
+}
+#endif
+
+// 计算 data 的 CRC32C；传入上一段的结果作为 crc 可以分段累计。
+// 支持 SSE4.2 的 x86 处理器上使用硬件指令，其余情况查表
+inline std::uint32_t crc32c(std::span<char const> data, std::uint32_t crc = 0) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    if (crc32cHasHardware()) [[likely]] {
+        return ~crc32cHardware(data, ~crc);
+    }
+#endif
+    return ~crc32cSoftware(data, ~crc);
+}
+
+} // namespace co_async
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "error_handling.hpp"
+#include "socket.hpp"
+#include "task.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <netinet/udp.h>
+#include <span>
+#include <stdexcept>
+#include <sys/socket.h>
+
+namespace co_async {
+
+// 控制消息缓冲区。协程帧里局部变量声明上的 alignas 不一定生效（GCC 12 会忽略），改由类型本身的对齐保证 cmsghdr 对齐
+template <std::size_t N>
+struct alignas(cmsghdr) CmsgBuffer {
+    char mData[N];
+};
+
+// 一组可复用的报文槽位：所有负载共用一块连续内存，mmsghdr/iovec/地址在构造时一次性分配，
+// 之后每次 recv_many/send_many 都不再分配内存，来源地址由内核直接写进槽位里的 SocketAddress
+struct DatagramBatch {
+    explicit DatagramBatch(std::size_t capacity = 64, std::size_t slotSize = 2048)
+        : mSlab(std::make_unique<char[]>(capacity * slotSize)),
+          mHeaders(std::make_unique<mmsghdr[]>(capacity)),
+          mIovecs(std::make_unique<iovec[]>(capacity)),
+          mAddrs(std::make_unique<SocketAddress[]>(capacity)),
+          mCapacity(capacity),
+          mSlotSize(slotSize) {}
+
+    std::size_t size() const noexcept { return mSize; }
+    std::size_t capacity() const noexcept { return mCapacity; }
+    bool empty() const noexcept { return mSize == 0; }
+    void clear() noexcept { mSize = 0; }
+
+    std::span<char const> data(std::size_t i) const noexcept { return {slot(i), mHeaders[i].msg_len}; }
+    const SocketAddress& address(std::size_t i) const noexcept { return mAddrs[i]; }
+    bool truncated(std::size_t i) const noexcept { return mHeaders[i].msg_hdr.msg_flags & MSG_TRUNC; }
+
+    // 追加一条待发送的报文，负载被拷贝进槽位；槽位已满时返回 false
+    bool push(std::span<char const> data, const SocketAddress& addr) {
+        if (mSize == mCapacity) [[unlikely]] {
+            return false;
+        }
+        if (data.size() > mSlotSize) [[unlikely]] {
+            throw std::length_error("datagram larger than batch slot");
+        }
+        std::copy(data.begin(), data.end(), slot(mSize));
+        mHeaders[mSize].msg_len = data.size();
+        mAddrs[mSize] = addr;
+        ++mSize;
+        return true;
+    }
+
+    mmsghdr* prepareRecv() noexcept {
+        for (std::size_t i = 0; i < mCapacity; ++i) {
+            mAddrs[i].mAddrLen = sizeof(mAddrs[i].mAddr);
+            setupHeader(i, mSlotSize);
+        }
+        return mHeaders.get();
+    }
+
+    mmsghdr* prepareSend() noexcept {
+        for (std::size_t i = 0; i < mSize; ++i) {
+            setupHeader(i, mHeaders[i].msg_len);
+        }
+        return mHeaders.get();
+    }
+
+    void finishRecv(std::size_t n) noexcept {
+        for (std::size_t i = 0; i < n; ++i) {
+            mAddrs[i].mAddrLen = mHeaders[i].msg_hdr.msg_namelen;
+        }
+        mSize = n;
+    }
+
+  private:
+    char* slot(std::size_t i) const noexcept { return mSlab.get() + i * mSlotSize; }
+
+    void setupHeader(std::size_t i, std::size_t len) noexcept {
+        mIovecs[i] = {slot(i), len};
+        auto& hdr = mHeaders[i].msg_hdr;
+        hdr = {};
+        hdr.msg_name = &mAddrs[i].mAddr;
+        hdr.msg_namelen = mAddrs[i].mAddrLen;
+        hdr.msg_iov = &mIovecs[i];
+        hdr.msg_iovlen = 1;
+    }
+
+    std::unique_ptr<char[]> mSlab;
+    std::unique_ptr<mmsghdr[]> mHeaders;
+    std::unique_ptr<iovec[]> mIovecs;
+    std::unique_ptr<SocketAddress[]> mAddrs;
+    std::size_t mSize = 0;
+    std::size_t mCapacity;
+    std::size_t mSlotSize;
+};
+
+// GRO 收到的超级报文：由若干等长分段首尾相接组成（最后一段可以更短）
+struct DatagramSegments {
+    std::span<char const> mData;
+    std::size_t mSegmentSize;
+
+    std::size_t size() const noexcept { return mData.empty() ? 0 : (mData.size() + mSegmentSize - 1) / mSegmentSize; }
+    std::span<char const> operator[](std::size_t i) const noexcept {
+        std::size_t offset = i * mSegmentSize;
+        return mData.subspan(offset, std::min(mSegmentSize, mData.size() - offset));
+    }
+};
+
+// 单次 UDP_SEGMENT 发送的上限：载荷不超过 64 KiB，且分段数不超过内核的 UDP_MAX_SEGMENTS
+inline constexpr std::size_t kMaxGsoBytes = 65507;
+inline constexpr std::size_t kMaxGsoSegments = 64;
+
+// 套接字总是非阻塞的：先直接尝试收发，只有内核队列为空/满时才经由 epoll 等待，
+// 高包率下绝大多数调用不需要 epoll 往返
+struct [[nodiscard]] AsyncDatagramSocket {
+    AsyncDatagramSocket() noexcept : mLoop(nullptr) {}
+    AsyncDatagramSocket(EpollLoop& loop, AsyncFile&& file) : mLoop(&loop), mFile(std::move(file)) {
+        mFile.setNonblock();
+    }
+
+    AsyncFile& file() noexcept { return mFile; }
+
+    Task<std::size_t> recv_from(std::span<char> buffer, SocketAddress& from) {
+        while (true) {
+            from.mAddrLen = sizeof(from.mAddr);
+            ssize_t res = recvfrom(
+                mFile.fileNo(), buffer.data(), buffer.size(), MSG_DONTWAIT, (sockaddr*)&from.mAddr, &from.mAddrLen);
+            if (checkErrorNonBlock(res, -1, EAGAIN) != -1) {
+                if (inlineLimitReached()) {
+                    co_await mLoop->yield();
+                }
+                co_return res;
+            }
+            mInlineCount = 0;
+            co_await wait_file_event(*mLoop, mFile, EPOLLIN);
+        }
+    }
+
+    Task<std::size_t> send_to(std::span<char const> buffer, const SocketAddress& to) {
+        while (true) {
+            ssize_t res = sendto(mFile.fileNo(),
+                                 buffer.data(),
+                                 buffer.size(),
+                                 MSG_DONTWAIT | MSG_NOSIGNAL,
+                                 (const sockaddr*)&to.mAddr,
+                                 to.mAddrLen);
+            if (checkErrorNonBlock(res, -1, EAGAIN) != -1) {
+                if (inlineLimitReached()) {
+                    co_await mLoop->yield();
+                }
+                co_return res;
+            }
+            mInlineCount = 0;
+            co_await wait_file_event(*mLoop, mFile, EPOLLOUT);
+        }
+    }
+
+    // 一次 recvmmsg 最多收取 batch.capacity() 条报文，返回收到的条数（至少为 1）
+    Task<std::size_t> recv_many(DatagramBatch& batch) {
+        while (true) {
+            int res = recvmmsg(mFile.fileNo(), batch.prepareRecv(), batch.capacity(), MSG_DONTWAIT, nullptr);
+            if (checkErrorNonBlock(res, -1, EAGAIN) != -1) {
+                batch.finishRecv(res);
+                if (inlineLimitReached()) {
+                    co_await mLoop->yield();
+                }
+                co_return res;
+            }
+            mInlineCount = 0;
+            co_await wait_file_event(*mLoop, mFile, EPOLLIN);
+        }
+    }
+
+    // 发送 batch 中的全部报文，内核一次未能全部接收时继续发送剩余部分
+    Task<std::size_t> send_many(DatagramBatch& batch) {
+        mmsghdr* headers = batch.prepareSend();
+        std::size_t sent = 0;
+        while (sent < batch.size()) {
+            int res = sendmmsg(mFile.fileNo(), headers + sent, batch.size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (checkErrorNonBlock(res, -1, EAGAIN) != -1) {
+                sent += res;
+                continue;
+            }
+            mInlineCount = 0;
+            co_await wait_file_event(*mLoop, mFile, EPOLLOUT);
+        }
+        if (inlineLimitReached()) {
+            co_await mLoop->yield();
+        }
+        co_return sent;
+    }
+
+    // 开启后内核会把同一条流上连续到达的等长报文合并，recv_segments 一次收取一个超级报文
+    void enable_gro(bool enable = true) { socketSetOption<int>(mFile, SOL_UDP, UDP_GRO, enable); }
+
+    // GSO：data 按 segmentSize 切分成多条报文，由一次 sendmsg 交给内核完成分段。
+    // 内核以 16 位整数接收段长，segmentSize 须在 1 到 65535 之间
+    Task<std::size_t> send_segmented(std::span<char const> data, std::size_t segmentSize, const SocketAddress& to) {
+        if (segmentSize == 0 || segmentSize > UINT16_MAX) [[unlikely]] {
+            throw std::invalid_argument("UDP_SEGMENT size must be between 1 and 65535");
+        }
+        if (data.size() > kMaxGsoBytes || (data.size() + segmentSize - 1) / segmentSize > kMaxGsoSegments)
+            [[unlikely]] {
+            throw std::length_error("too many bytes or segments for one UDP_SEGMENT send");
+        }
+        CmsgBuffer<CMSG_SPACE(sizeof(std::uint16_t))> control{};
+        iovec iov{const_cast<char*>(data.data()), data.size()};
+        msghdr msg{};
+        msg.msg_name = const_cast<sockaddr_storage*>(&to.mAddr);
+        msg.msg_namelen = to.mAddrLen;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.mData;
+        msg.msg_controllen = sizeof(control.mData);
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+        std::uint16_t gsoSize = segmentSize;
+        std::memcpy(CMSG_DATA(cm), &gsoSize, sizeof(gsoSize));
+        while (true) {
+            ssize_t res = sendmsg(mFile.fileNo(), &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (checkErrorNonBlock(res, -1, EAGAIN) != -1) {
+                if (inlineLimitReached()) {
+                    co_await mLoop->yield();
+                }
+                co_return res;
+            }
+            mInlineCount = 0;
+            co_await wait_file_event(*mLoop, mFile, EPOLLOUT);
+        }
+    }
+
+    // 收取一个（可能经 GRO 合并的）报文，buffer 应足够容纳 64 KiB；未合并时视为只有一段
+    Task<DatagramSegments> recv_segments(std::span<char> buffer, SocketAddress& from) {
+        CmsgBuffer<CMSG_SPACE(sizeof(int))> control;
+        iovec iov{buffer.data(), buffer.size()};
+        msghdr msg{};
+        msg.msg_name = &from.mAddr;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        while (true) {
+            msg.msg_namelen = sizeof(from.mAddr);
+            msg.msg_control = control.mData;
+            msg.msg_controllen = sizeof(control.mData);
+            ssize_t res = recvmsg(mFile.fileNo(), &msg, MSG_DONTWAIT);
+            if (checkErrorNonBlock(res, -1, EAGAIN) != -1) {
+                from.mAddrLen = msg.msg_namelen;
+                std::size_t segmentSize = res;
+                for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+                    if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+                        int gsoSize;
+                        std::memcpy(&gsoSize, CMSG_DATA(cm), sizeof(gsoSize));
+                        segmentSize = gsoSize;
+                    }
+                }
+                if (inlineLimitReached()) {
+                    co_await mLoop->yield();
+                }
+                co_return DatagramSegments{std::span<char const>(buffer.data(), res),
+                                           std::max<std::size_t>(segmentSize, 1)};
+            }
+            mInlineCount = 0;
+            co_await wait_file_event(*mLoop, mFile, EPOLLIN);
+        }
+    }
+
+  private:
+    // 不经 epoll 就完成的调用连续 kInlineLimit 次后回到 loop 一次：调用方的收发循环若从不挂起，
+    // 每次完成都经对称转移回到调用方，未优化的构建中这不是尾调用，栈会不断加深
+    static constexpr unsigned kInlineLimit = 64;
+
+    bool inlineLimitReached() noexcept {
+        if (++mInlineCount < kInlineLimit) {
+            return false;
+        }
+        mInlineCount = 0;
+        return true;
+    }
+
+    EpollLoop* mLoop;
+    AsyncFile mFile;
+    unsigned mInlineCount = 0;
+};
+
+} // namespace co_async
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "buffer_pool.hpp"
+#include "regular_file.hpp"
+#include "task.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace co_async {
+
+// O_DIRECT 要求缓冲区地址、长度和文件偏移都按设备逻辑块对齐，4 KiB 满足常见设备
+inline constexpr std::size_t kDirectAlignment = 4096;
+
+// 按 kDirectAlignment 对齐、容量为其整数倍的缓冲区，供 O_DIRECT 读写直接使用。
+// 作为流的存储时，首次使用才分配，之后一直保留到析构
+struct AlignedBuffer {
+    static constexpr bool kMirrored = false;
+    static constexpr std::size_t kDefaultSize = 65536;
+
+    explicit AlignedBuffer(std::size_t size = kDefaultSize) noexcept
+        : mSize(size == 0 ? kDirectAlignment : (size + kDirectAlignment - 1) / kDirectAlignment * kDirectAlignment) {}
+    AlignedBuffer(AlignedBuffer&& that) noexcept : mData(std::exchange(that.mData, nullptr)), mSize(that.mSize) {}
+    AlignedBuffer& operator=(AlignedBuffer&& that) noexcept {
+        std::swap(mData, that.mData);
+        std::swap(mSize, that.mSize);
+        return *this;
+    }
+    ~AlignedBuffer() { std::free(mData); }
+
+    char* data() const noexcept { return mData; }
+    std::size_t size() const noexcept { return mSize; }
+    bool allocated() const noexcept { return mData != nullptr; }
+    char& operator[](std::size_t i) const noexcept { return mData[i]; }
+
+    void allocate() {
+        if (!mData) {
+            void* p;
+            if (int err = posix_memalign(&p, kDirectAlignment, mSize)) [[unlikely]] {
+                throw std::system_error(err, std::system_category());
+            }
+            mData = static_cast<char*>(p);
+        }
+    }
+
+    void acquire(BufferPool&) { allocate(); }
+    void release() noexcept {}
+
+  private:
+    char* mData = nullptr;
+    std::size_t mSize;
+};
+
+inline bool isDirectAligned(void const* p) noexcept {
+    return reinterpret_cast<std::uintptr_t>(p) % kDirectAlignment == 0;
+}
+
+// 以 O_DIRECT 打开的文件为源/目的地的 StreamBuf，绕过页缓存，从对齐的 offset 开始顺序读写。
+// 配合 AlignedBuffer 存储时，流缓冲区的整块部分直接交给 pread/pwrite；
+// 地址不对齐的部分和不足一块的尾部经由内部的对齐中转缓冲区：
+// 尾部补零写成整块后把文件截断到实际长度，下次写入时补齐并重写该块。
+// 文件读到不足一块时视为已到末尾。中转缓冲区读写共用，同一个 DirectFileBuf 只用于一个方向
+struct DirectFileBuf {
+    static constexpr std::size_t kBounceSize = 65536;
+
+    DirectFileBuf(AsyncRegularFile file, off_t offset = 0) : mFile(std::move(file)), mOffset(offset) {
+        if (offset % kDirectAlignment != 0) [[unlikely]] {
+            throw std::invalid_argument("O_DIRECT offset must be block aligned");
+        }
+    }
+    DirectFileBuf(DirectFileBuf&&) = default;
+    DirectFileBuf& operator=(DirectFileBuf&&) = default;
+
+    AsyncRegularFile& file() noexcept { return mFile; }
+
+    Task<std::size_t> read(std::span<char> buffer) {
+        if (mBouncePos != mBounceLen) {
+            co_return takeBounce(buffer);
+        }
+        if (mEof) {
+            co_return 0;
+        }
+        if (isDirectAligned(buffer.data()) && buffer.size() >= kDirectAlignment) {
+            co_return co_await readBlocks(buffer.first(buffer.size() / kDirectAlignment * kDirectAlignment));
+        }
+        mBounce.allocate();
+        mBouncePos = 0;
+        mBounceLen = co_await readBlocks(std::span(mBounce.data(), mBounce.size()));
+        co_return takeBounce(buffer);
+    }
+
+    Task<std::size_t> write(std::span<char const> buffer) {
+        std::size_t total = buffer.size();
+        mBounce.allocate();
+        // 先补齐上次留下的尾块
+        if (mTailLen) {
+            std::size_t len = std::min(kDirectAlignment - mTailLen, buffer.size());
+            std::memcpy(mBounce.data() + mTailLen, buffer.data(), len);
+            mTailLen += len;
+            buffer = buffer.subspan(len);
+            if (mTailLen == kDirectAlignment) {
+                co_await writeBlocks(std::span<char const>(mBounce.data(), kDirectAlignment));
+                mTailLen = 0;
+            }
+        }
+        std::size_t whole = buffer.size() / kDirectAlignment * kDirectAlignment;
+        if (whole && isDirectAligned(buffer.data())) {
+            co_await writeBlocks(buffer.first(whole));
+            buffer = buffer.subspan(whole);
+        }
+        while (buffer.size() >= kDirectAlignment) {
+            std::size_t len = std::min(buffer.size(), mBounce.size()) / kDirectAlignment * kDirectAlignment;
+            std::memcpy(mBounce.data(), buffer.data(), len);
+            co_await writeBlocks(std::span<char const>(mBounce.data(), len));
+            buffer = buffer.subspan(len);
+        }
+        if (!buffer.empty()) {
+            std::memcpy(mBounce.data() + mTailLen, buffer.data(), buffer.size());
+            mTailLen += buffer.size();
+        }
+        if (mTailLen) {
+            std::memset(mBounce.data() + mTailLen, 0, kDirectAlignment - mTailLen);
+            co_await mFile.pwrite(mOffset, std::span<char const>(mBounce.data(), kDirectAlignment));
+            co_await mFile.truncate(mOffset + mTailLen);
+        }
+        co_return total;
+    }
+
+  private:
+    Task<std::size_t> readBlocks(std::span<char> blocks) {
+        std::size_t len = co_await mFile.pread(mOffset, blocks);
+        mOffset += len;
+        if (len % kDirectAlignment != 0 || len == 0) {
+            mEof = true;
+        }
+        co_return len;
+    }
+
+    Task<> writeBlocks(std::span<char const> blocks) {
+        co_await mFile.pwrite(mOffset, blocks);
+        mOffset += blocks.size();
+    }
+
+    std::size_t takeBounce(std::span<char> buffer) noexcept {
+        std::size_t len = std::min(buffer.size(), mBounceLen - mBouncePos);
+        std::memcpy(buffer.data(), mBounce.data() + mBouncePos, len);
+        mBouncePos += len;
+        return len;
+    }
+
+    AsyncRegularFile mFile;
+    off_t mOffset;
+    AlignedBuffer mBounce{kBounceSize};
+    std::size_t mBouncePos = 0; // 读：中转缓冲区中尚未交出的数据 [mBouncePos, mBounceLen)
+    std::size_t mBounceLen = 0;
+    std::size_t mTailLen = 0; // 写：中转缓冲区开头不足一块的尾部
+    bool mEof = false;
+};
+
+inline Task<AsyncRegularFile> open_direct_file(OffloadPool& pool, const char* path, int flags = O_RDONLY,
+                                               mode_t mode = 0644) {
+    return open_regular_file(pool, path, flags | O_DIRECT, mode);
+}
+
+} // namespace co_async
@@ -2,6 +2,7 @@
 
 #include "error_handling.hpp"
 #include "task.hpp"
+#include "wait_queue.hpp"
 
 #include <chrono>
 #include <optional>
@@ -16,6 +17,9 @@ using EpollEventMask = std::uint32_t;
 
 struct EpollFilePromise : Promise<EpollEventMask> {
     struct EpollFileAwaiter* mAwaiter{};
+    bool mDispatched = false; // 事件已到达、排队等待本轮恢复
+    EpollFilePromise* mPrevWaiter = nullptr; // 同一 fd 同一方向的等待者链表
+    EpollFilePromise* mNextWaiter = nullptr;
 
     auto get_return_object() { return std::coroutine_handle<EpollFilePromise>::from_promise(*this); }
 
@@ -27,16 +31,55 @@ struct EpollLoop {
     int mEpoll = checkError(epoll_create1(0));
     std::size_t mCount = 0;
     struct epoll_event mEventBuf[64];
+    std::vector<EpollFilePromise*> mReady; // 本轮 epoll_wait 中事件已到达、尚未恢复的等待者
     std::vector<std::coroutine_handle<>> mQueue;
+    WaitQueue mTickEnd; // 等待本轮事件处理完毕的协程（如自动 flush）
+    WaitQueue mYielded; // 让出执行权、等下一轮 epoll_wait 之后再恢复的协程
 
     EpollLoop& operator=(EpollLoop&&) = delete;
     ~EpollLoop() { close(mEpoll); }
 
-    inline bool addListener(EpollFilePromise& promise, int ctl);
-    inline void removeListener(int fileNo);
+    inline bool addListener(EpollFilePromise& promise);
+    inline void removeListener(EpollFilePromise& promise);
+    inline void cancelReady(EpollFilePromise& promise) noexcept;
     inline bool run(std::optional<std::chrono::system_clock::duration> timeout = std::nullopt);
 
-    bool hasEvent() const noexcept { return mCount != 0; }
+    // co_await loop.tickEnd()：在本轮就绪事件全部分发完、再次阻塞于 epoll_wait 之前恢复
+    WaitQueue::Awaiter tickEnd() noexcept { return mTickEnd.wait(); }
+
+    // co_await loop.yield()：回到事件循环，处理完一轮（不阻塞的）epoll_wait 后再恢复。
+    // 用于截断一连串不挂起就完成的调用：此时调用链不会回到 loop，栈随每次完成加深，其他协程也得不到运行
+    WaitQueue::Awaiter yield() noexcept { return mYielded.wait(); }
+
+    bool hasEvent() const noexcept {
+        return mCount != 0 || !mQueue.empty() || !mTickEnd.empty() || !mYielded.empty();
+    }
+
+  private:
+    // 同一文件描述符上分读方向（等待 EPOLLIN）和其他方向（EPOLLOUT、EPOLLERR 等）排队等待，
+    // 如一个协程在读套接字的同时另一个在 flush。所有等待者的事件合并注册，到达后每个方向只按先来后到恢复一个：
+    // 一次就绪只够一个等待者读写，其余的留在队列中，fd 重新启用后仍就绪时下一轮再恢复下一个。
+    // 唤醒后描述符仍留在 epoll 中（EPOLLONESHOT 使其暂停），下次等待只需 EPOLL_CTL_MOD
+    struct FdState {
+        struct Waiters {
+            EpollFilePromise* mHead = nullptr;
+            EpollFilePromise* mTail = nullptr;
+        };
+
+        Waiters mWaiters[2];
+        bool mRegistered = false;
+
+        bool empty() const noexcept { return !mWaiters[0].mHead && !mWaiters[1].mHead; }
+    };
+
+    static int waiterSlot(EpollEventMask events) noexcept { return (events & EPOLLIN) ? 0 : 1; }
+
+    static inline void link(FdState::Waiters& list, EpollFilePromise& promise) noexcept;
+    static inline void unlink(FdState::Waiters& list, EpollFilePromise& promise) noexcept;
+    inline bool updateInterest(int fd);
+    inline void runReady();
+
+    std::vector<FdState> mFds; // 以文件描述符为下标
 };
 
 struct EpollFileAwaiter {
@@ -44,7 +87,6 @@ struct EpollFileAwaiter {
     int mFileNo;
     EpollEventMask mEvents;
     EpollEventMask mResumeEvents{};
-    int mCtlCode = EPOLL_CTL_ADD;
     EpollFileAwaiter(EpollLoop& loop, int fileNo, EpollEventMask events)
         : mLoop(loop),
           mFileNo(fileNo),
@@ -54,7 +96,14 @@ struct EpollFileAwaiter {
     void await_suspend(std::coroutine_handle<EpollFilePromise> coroutine) {
         auto& promise = coroutine.promise();
         promise.mAwaiter = this;
-        if (!mLoop.addListener(promise, mCtlCode)) {
+        bool waiting;
+        try {
+            waiting = mLoop.addListener(promise);
+        } catch (...) {
+            promise.mAwaiter = nullptr;
+            throw;
+        }
+        if (!waiting) {
             promise.mAwaiter = nullptr;
             coroutine.resume();
         }
@@ -64,54 +113,152 @@ struct EpollFileAwaiter {
 };
 
 EpollFilePromise::~EpollFilePromise() {
-    if (mAwaiter) {
-        mAwaiter->mLoop.removeListener(mAwaiter->mFileNo);
+    if (mDispatched) {
+        mAwaiter->mLoop.cancelReady(*this);
+    } else if (mAwaiter) {
+        mAwaiter->mLoop.removeListener(*this);
     }
 }
 
-bool EpollLoop::addListener(EpollFilePromise& promise, int ctl) {
+void EpollLoop::link(FdState::Waiters& list, EpollFilePromise& promise) noexcept {
+    promise.mPrevWaiter = list.mTail;
+    promise.mNextWaiter = nullptr;
+    (list.mTail ? list.mTail->mNextWaiter : list.mHead) = &promise;
+    list.mTail = &promise;
+}
+
+void EpollLoop::unlink(FdState::Waiters& list, EpollFilePromise& promise) noexcept {
+    (promise.mPrevWaiter ? promise.mPrevWaiter->mNextWaiter : list.mHead) = promise.mNextWaiter;
+    (promise.mNextWaiter ? promise.mNextWaiter->mPrevWaiter : list.mTail) = promise.mPrevWaiter;
+    promise.mPrevWaiter = promise.mNextWaiter = nullptr;
+}
+
+// 按当前等待者重新注册 fd 关心的事件；没有等待者时保持暂停状态，不必移出 epoll
+bool EpollLoop::updateInterest(int fd) {
+    auto& state = mFds[fd];
+    EpollEventMask mask = 0;
+    for (auto& list : state.mWaiters) {
+        for (auto* promise = list.mHead; promise; promise = promise->mNextWaiter) {
+            mask |= promise->mAwaiter->mEvents;
+        }
+    }
+    if (mask == 0) {
+        return true;
+    }
     struct epoll_event event;
-    event.events =
-        promise.mAwaiter->mEvents |
-        EPOLLONESHOT; // 确保同一个文件描述符(如socket)上的事件在同一时间最多被一个线程处理​​
-    event.data.ptr = &promise;
-    int res = epoll_ctl(mEpoll, ctl, promise.mAwaiter->mFileNo, &event);
-    if (res == -1)
+    event.events = mask | EPOLLONESHOT; // 确保同一个文件描述符(如socket)上的事件在同一时间最多被一个线程处理​​
+    event.data.fd = fd;
+    if (state.mRegistered) {
+        if (epoll_ctl(mEpoll, EPOLL_CTL_MOD, fd, &event) == 0) {
+            return true;
+        }
+        // 描述符关闭后内核已自动将其移出 epoll，编号又被新文件复用
+        if (errno != ENOENT) {
+            return false;
+        }
+        state.mRegistered = false;
+    }
+    if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, fd, &event) == -1) {
         return false;
-    if (ctl == EPOLL_CTL_ADD)
-        ++mCount;
+    }
+    state.mRegistered = true;
     return true;
 }
 
-void EpollLoop::removeListener(int fileNo) {
-    checkError(epoll_ctl(mEpoll, EPOLL_CTL_DEL, fileNo, NULL));
+bool EpollLoop::addListener(EpollFilePromise& promise) {
+    int fd = promise.mAwaiter->mFileNo;
+    if (static_cast<std::size_t>(fd) >= mFds.size()) {
+        mFds.resize(fd + 1);
+    }
+    auto& list = mFds[fd].mWaiters[waiterSlot(promise.mAwaiter->mEvents)];
+    link(list, promise);
+    if (!updateInterest(fd)) { // 如普通文件不支持 epoll，视为立即就绪
+        unlink(list, promise);
+        return false;
+    }
+    ++mCount;
+    return true;
+}
+
+// 等待被取消（如超时）时调用。fd 上已没有等待者时移出 epoll，避免它关闭后仍以旧注册触发事件
+void EpollLoop::removeListener(EpollFilePromise& promise) {
+    int fd = promise.mAwaiter->mFileNo;
+    auto& state = mFds[fd];
+    unlink(state.mWaiters[waiterSlot(promise.mAwaiter->mEvents)], promise);
     --mCount;
+    if (!state.empty()) {
+        checkError(updateInterest(fd) ? 0 : -1);
+    } else if (state.mRegistered) {
+        (void)epoll_ctl(mEpoll, EPOLL_CTL_DEL, fd, nullptr);
+        state.mRegistered = false;
+    }
 }
 
-bool EpollLoop::run(std::optional<std::chrono::system_clock::duration> timeout) {
-    while (!mQueue.empty()) {
-        auto task = mQueue.back();
-        mQueue.pop_back();
-        task.resume();
+// 同一轮中先被唤醒的协程可能取消（销毁）了另一个已就绪的等待者（如 when_any 的败者），
+// 需要把它从待恢复的队列中抹去，避免恢复已销毁的协程
+void EpollLoop::cancelReady(EpollFilePromise& promise) noexcept {
+    for (auto& ready : mReady) {
+        if (ready == &promise) {
+            ready = nullptr;
+        }
+    }
+}
+
+void EpollLoop::runReady() {
+    while (!mQueue.empty() || !mTickEnd.empty()) {
+        while (!mQueue.empty()) {
+            auto task = mQueue.back();
+            mQueue.pop_back();
+            task.resume();
+        }
+        mTickEnd.notify_all();
     }
-    if (mCount == 0) {
+}
+
+bool EpollLoop::run(std::optional<std::chrono::system_clock::duration> timeout) {
+    runReady();
+    if (mCount == 0 && mYielded.empty()) {
         return false;
     }
     int timeoutInMs = -1;
-    if (timeout) {
+    if (!mYielded.empty()) {
+        timeoutInMs = 0;
+    } else if (timeout) {
         timeoutInMs = std::chrono::duration_cast<std::chrono::milliseconds>(*timeout).count();
     }
-    int res = checkError(epoll_wait(mEpoll, mEventBuf, std::size(mEventBuf), timeoutInMs));
+    // 只有让出执行权的协程、没有 fd 在等待时不必进入内核
+    int res = mCount == 0 ? 0 : checkError(epoll_wait(mEpoll, mEventBuf, std::size(mEventBuf), timeoutInMs));
     for (int i = 0; i < res; ++i) {
         auto& event = mEventBuf[i];
-        auto& promise = *(EpollFilePromise*)event.data.ptr;
-        promise.mAwaiter->mResumeEvents = event.events;
+        auto& state = mFds[event.data.fd];
+        for (auto& list : state.mWaiters) {
+            for (auto* promise = list.mHead; promise; promise = promise->mNextWaiter) {
+                // 错误和挂断对所有等待者都是事件
+                if (event.events & (promise->mAwaiter->mEvents | EPOLLERR | EPOLLHUP)) {
+                    unlink(list, *promise);
+                    promise->mAwaiter->mResumeEvents = event.events;
+                    promise->mDispatched = true;
+                    mReady.push_back(promise);
+                    --mCount;
+                    break;
+                }
+            }
+        }
+        // 还有等待者没有被唤醒，重新启用 fd
+        if (!state.empty()) {
+            checkError(updateInterest(event.data.fd) ? 0 : -1);
+        }
     }
-    for (int i = 0; i < res; ++i) {
-        auto& event = mEventBuf[i];
-        auto& promise = *(EpollFilePromise*)event.data.ptr;
-        std::coroutine_handle<EpollFilePromise>::from_promise(promise).resume();
+    for (std::size_t i = 0; i < mReady.size(); ++i) {
+        if (auto* promise = mReady[i]) {
+            promise->mDispatched = false;
+            promise->mAwaiter = nullptr;
+            std::coroutine_handle<EpollFilePromise>::from_promise(*promise).resume();
+        }
     }
+    mReady.clear();
+    mYielded.notify_all();
+    runReady();
     return true;
 }
 
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "crc32c.hpp"
+#include "task.hpp"
+
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace co_async {
+
+// 二进制协议的公共部分：定长整数（可指定字节序）、varint（LEB128）以及带长度前缀的帧。
+// 读取都直接在流缓冲区上用 ensure/peek/consume 完成，每个整数或帧只经过一次协程调用
+
+template <std::unsigned_integral U>
+constexpr U byteSwap(U value) noexcept {
+    if constexpr (sizeof(U) == 1) {
+        return value;
+    } else if constexpr (sizeof(U) == 2) {
+        return __builtin_bswap16(value);
+    } else if constexpr (sizeof(U) == 4) {
+        return __builtin_bswap32(value);
+    } else {
+        static_assert(sizeof(U) == 8);
+        return __builtin_bswap64(value);
+    }
+}
+
+template <std::integral T>
+inline T loadFixed(char const* p, std::endian order = std::endian::little) noexcept {
+    std::make_unsigned_t<T> value;
+    std::memcpy(&value, p, sizeof value);
+    if (order != std::endian::native) {
+        value = byteSwap(value);
+    }
+    return static_cast<T>(value);
+}
+
+template <std::integral T>
+inline void storeFixed(char* p, T value, std::endian order = std::endian::little) noexcept {
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    if (order != std::endian::native) {
+        bits = byteSwap(bits);
+    }
+    std::memcpy(p, &bits, sizeof bits);
+}
+
+// T 的 varint 编码最多占用的字节数
+template <std::unsigned_integral T>
+inline constexpr std::size_t kMaxVarintSize = (sizeof(T) * 8 + 6) / 7;
+
+// 写入 p 并返回编码长度，p 至少要有 kMaxVarintSize<T> 字节
+template <std::unsigned_integral T>
+inline std::size_t encodeVarint(char* p, T value) noexcept {
+    std::size_t len = 0;
+    while (value >= 0x80) {
+        p[len++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    p[len++] = static_cast<char>(value);
+    return len;
+}
+
+// 返回 {值, 编码长度}；buf 中的数据还不完整时长度为 0。
+// 超过 kMaxVarintSize<T> 字节或超出 T 的范围时抛出 std::out_of_range
+template <std::unsigned_integral T>
+inline std::pair<T, std::size_t> decodeVarint(std::span<char const> buf) {
+    T value = 0;
+    for (std::size_t i = 0; i < buf.size() && i < kMaxVarintSize<T>; ++i) {
+        auto byte = static_cast<unsigned char>(buf[i]);
+        if (i == kMaxVarintSize<T> - 1 && (byte >> (sizeof(T) * 8 - 7 * i)) != 0) [[unlikely]] {
+            throw std::out_of_range("varint exceeds integer range");
+        }
+        value |= static_cast<T>(static_cast<T>(byte & 0x7F) << (7 * i));
+        if (!(byte & 0x80)) {
+            return {value, i + 1};
+        }
+    }
+    return {0, 0};
+}
+
+// 读取一个 sizeof(T) 字节、字节序为 order 的整数
+template <std::integral T, class Stream>
+Task<T> read_fixed(Stream& stream, std::endian order = std::endian::little) {
+    auto buf = co_await stream.ensure(sizeof(T));
+    T value = loadFixed<T>(buf.data(), order);
+    stream.consume(sizeof(T));
+    co_return value;
+}
+
+template <class Stream, std::integral T>
+Task<> write_fixed(Stream& stream, T value, std::endian order = std::endian::little) {
+    char buf[sizeof(T)];
+    storeFixed(buf, value, order);
+    co_await stream.puts(std::string_view(buf, sizeof buf));
+}
+
+// 未读区中已有完整的 varint 时直接解码，否则每次多等待一个字节
+template <std::unsigned_integral T = std::uint64_t, class Stream>
+Task<T> read_varint(Stream& stream) {
+    std::size_t need = 1;
+    while (true) {
+        auto buf = stream.peek();
+        if (buf.size() < need) {
+            buf = co_await stream.ensure(need);
+        }
+        auto [value, len] = decodeVarint<T>(buf);
+        if (len) {
+            stream.consume(len);
+            co_return value;
+        }
+        need = buf.size() + 1;
+    }
+}
+
+template <class Stream, std::unsigned_integral T>
+Task<> write_varint(Stream& stream, T value) {
+    char buf[kMaxVarintSize<T>];
+    co_await stream.puts(std::string_view(buf, encodeVarint(buf, value)));
+}
+
+enum class FramePrefix {
+    Varint,
+    Fixed16,
+    Fixed32,
+};
+
+// 帧格式：长度前缀 + 载荷 [+ 4 字节载荷的 CRC32C]。定长前缀和校验和的字节序均为 mEndian
+struct FrameFormat {
+    FramePrefix mPrefix = FramePrefix::Varint;
+    std::endian mEndian = std::endian::big;
+    bool mChecksum = false;
+    std::size_t mMaxSize = std::size_t(16) << 20; // 超过此长度的帧视为格式错误
+};
+
+// 依次写出前缀、载荷和校验和
+template <class Stream>
+Task<> write_frame(Stream& stream, std::span<char const> payload, FrameFormat format = {}) {
+    if (payload.size() > format.mMaxSize) [[unlikely]] {
+        throw std::length_error("frame exceeds maximum size");
+    }
+    char header[kMaxVarintSize<std::uint64_t>];
+    std::size_t headerLen = 0;
+    switch (format.mPrefix) {
+    case FramePrefix::Varint: headerLen = encodeVarint<std::uint64_t>(header, payload.size()); break;
+    case FramePrefix::Fixed16:
+        if (payload.size() > 0xFFFF) [[unlikely]] {
+            throw std::length_error("frame exceeds 16-bit length prefix");
+        }
+        storeFixed<std::uint16_t>(header, payload.size(), format.mEndian);
+        headerLen = 2;
+        break;
+    case FramePrefix::Fixed32:
+        if (payload.size() > 0xFFFFFFFF) [[unlikely]] {
+            throw std::length_error("frame exceeds 32-bit length prefix");
+        }
+        storeFixed<std::uint32_t>(header, payload.size(), format.mEndian);
+        headerLen = 4;
+        break;
+    }
+    co_await stream.puts(std::string_view(header, headerLen));
+    co_await stream.puts(std::string_view(payload.data(), payload.size()));
+    if (format.mChecksum) {
+        co_await write_fixed(stream, crc32c(payload), format.mEndian);
+    }
+}
+
+// 从流中逐帧读取。帧能放进流缓冲区时，返回的载荷直接指向缓冲区，不做复制，
+// 待下一次 read_frame() 时才从流中消耗；超过缓冲区容量的帧复制到内部字符串中。
+// 返回的载荷在下一次 read_frame()、直接读取该流或 FrameReader 析构之前有效；析构时消耗最后一帧，流可以交给别的读取者。
+// 校验和不符时跳过该帧并抛出 std::runtime_error；EOF 时与流的其他读取一样抛出 EOFException
+template <class Stream>
+struct FrameReader {
+    explicit FrameReader(Stream& stream, FrameFormat format = {}) noexcept : mStream(stream), mFormat(format) {}
+    FrameReader(FrameReader&&) = delete;
+    ~FrameReader() {
+        if (mPending) {
+            mStream.consume(mPending);
+        }
+    }
+
+    Task<std::span<char const>> read_frame() {
+        if (mPending) {
+            mStream.consume(std::exchange(mPending, 0));
+        }
+        std::uint64_t len = 0;
+        switch (mFormat.mPrefix) {
+        case FramePrefix::Varint: len = co_await read_varint<std::uint64_t>(mStream); break;
+        case FramePrefix::Fixed16: len = co_await read_fixed<std::uint16_t>(mStream, mFormat.mEndian); break;
+        case FramePrefix::Fixed32: len = co_await read_fixed<std::uint32_t>(mStream, mFormat.mEndian); break;
+        }
+        if (len > mFormat.mMaxSize) [[unlikely]] {
+            throw std::length_error("frame exceeds maximum size");
+        }
+        std::size_t total = len + (mFormat.mChecksum ? 4 : 0);
+        std::span<char const> frame;
+        if (total <= mStream.ensure_limit()) {
+            auto buf = co_await mStream.ensure(total);
+            frame = buf.first(total);
+            mPending = total;
+        } else {
+            mLarge = co_await mStream.getn(total);
+            frame = mLarge;
+        }
+        auto payload = frame.first(len);
+        if (mFormat.mChecksum) {
+            if (loadFixed<std::uint32_t>(frame.data() + len, mFormat.mEndian) != crc32c(payload)) [[unlikely]] {
+                throw std::runtime_error("frame checksum mismatch");
+            }
+        }
+        co_return payload;
+    }
+
+  private:
+    Stream& mStream;
+    FrameFormat mFormat;
+    std::size_t mPending = 0; // 上一帧留在缓冲区中、尚未消耗的字节数
+    std::string mLarge;
+};
+
+} // namespace co_async
@@ -89,7 +89,10 @@ struct [[nodiscard]] Generator {
 
     Generator(std::coroutine_handle<promise_type> coroutine = nullptr) noexcept : mHandle(coroutine) {}
     Generator(Generator&& that) noexcept : mHandle(that.mHandle) { that.mHandle = nullptr; }
-    Generator& operator=(Generator&& that) noexcept { std::swap(mHandle, that.mHandle); }
+    Generator& operator=(Generator&& that) noexcept {
+        std::swap(mHandle, that.mHandle);
+        return *this;
+    }
     ~Generator() {
         if (mHandle)
             mHandle.destroy();
@@ -113,6 +116,7 @@ struct [[nodiscard]] Generator {
         }
     };
     operator std::coroutine_handle<promise_type>() const noexcept { return mHandle; }
+    explicit operator bool() const noexcept { return static_cast<bool>(mHandle); }
 
   private:
     std::coroutine_handle<promise_type> mHandle;
@@ -0,0 +1,495 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "generator.hpp"
+#include "http_parser.hpp"
+#include "limit_timeout.hpp"
+#include "stream_base.hpp"
+#include "task.hpp"
+#include "timer_loop.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace co_async {
+
+// 逗号分隔的列表（如 Connection、Transfer-Encoding）中是否含有 token
+inline bool httpHasToken(std::string_view list, std::string_view token) noexcept {
+    while (!list.empty()) {
+        std::size_t comma = list.find(',');
+        auto item = list.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (httpNameEquals(item, token)) {
+            return true;
+        }
+        if (comma == list.npos) {
+            break;
+        }
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+// 请求。头部各字段指向连接的读缓冲区（有正文时指向服务器复制出的头部），在处理函数返回前有效
+struct HttpRequest : HttpRequestHead {
+    // 请求正文，只能读取一次；处理函数没有读完的部分由服务器丢弃
+    Task<std::string> read_body();
+    Generator<std::string> body_stream();
+
+    struct BodyReader {
+        // 返回下一段正文，指向连接的读缓冲区，在下一次调用前有效；读完后返回空
+        virtual Task<std::span<char const>> read_some() = 0;
+    };
+    BodyReader* mBody = nullptr;
+};
+
+inline Task<std::string> HttpRequest::read_body() {
+    std::string body;
+    while (true) {
+        auto chunk = co_await mBody->read_some();
+        if (chunk.empty()) {
+            break;
+        }
+        body.append(chunk.data(), chunk.size());
+    }
+    co_return body;
+}
+
+inline Generator<std::string> HttpRequest::body_stream() {
+    while (true) {
+        auto chunk = co_await mBody->read_some();
+        if (chunk.empty()) {
+            break;
+        }
+        co_yield std::string(chunk.data(), chunk.size());
+    }
+}
+
+// 响应：正文为 mBody，或者由 mBodyStream 逐段产生（以 chunked 编码发出）
+struct HttpResponse {
+    int mStatus = 200;
+    std::vector<std::pair<std::string, std::string>> mHeaders;
+    std::string mBody;
+    Generator<std::string> mBodyStream;
+};
+
+inline std::string_view httpReasonPhrase(int status) noexcept {
+    switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 411: return "Length Required";
+    case 413: return "Content Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+// 正文解码：按 Content-Length 定长，按 chunked 编码逐块读取，或读到连接关闭；chunk 扩展和尾部字段被忽略。
+// 每次返回的一段直接指向流缓冲区，在下一次调用时才从流中消耗
+template <class Stream>
+struct HttpBodyDecoder final : HttpRequest::BodyReader {
+    explicit HttpBodyDecoder(Stream& stream) noexcept : mStream(stream) {}
+
+    void reset_length(std::uint64_t length) noexcept {
+        mChunked = false;
+        mUntilClose = false;
+        mRemaining = length;
+        mDone = length == 0;
+    }
+
+    void reset_chunked() noexcept {
+        mChunked = true;
+        mRemaining = 0;
+        mFirstChunk = true;
+        mDone = false;
+    }
+
+    // 正文一直读到连接关闭（没有长度信息的 HTTP 响应）
+    void reset_until_close() noexcept {
+        reset_length(UINT64_MAX);
+        mUntilClose = true;
+    }
+
+    Task<std::span<char const>> read_some() override {
+        if (mPending) {
+            mStream.consume(std::exchange(mPending, 0));
+        }
+        if (mDone) {
+            co_return std::span<char const>();
+        }
+        if (mChunked && mRemaining == 0) {
+            if (!mFirstChunk) {
+                co_await expectLine();
+            }
+            mFirstChunk = false;
+            auto line = co_await readLine();
+            std::uint64_t size = 0;
+            auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), size, 16);
+            if (ec != std::errc() || ptr == line.data()) [[unlikely]] {
+                throw HttpError(400, "malformed chunk size");
+            }
+            mStream.consume(mLineLength);
+            if (size == 0) {
+                // 跳过尾部字段直到空行
+                while (true) {
+                    auto trailer = co_await readLine();
+                    mStream.consume(mLineLength);
+                    if (trailer.empty()) {
+                        break;
+                    }
+                }
+                mDone = true;
+                co_return std::span<char const>();
+            }
+            mRemaining = size;
+        }
+        auto buf = mStream.peek();
+        if (buf.empty()) {
+            if (mUntilClose) {
+                try {
+                    buf = co_await mStream.ensure(1);
+                } catch (EOFException const&) {
+                    mDone = true;
+                }
+                if (mDone) {
+                    co_return std::span<char const>();
+                }
+            } else {
+                buf = co_await mStream.ensure(1);
+            }
+        }
+        std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(buf.size(), mRemaining));
+        mRemaining -= n;
+        mPending = n;
+        if (!mChunked && mRemaining == 0) {
+            mDone = true;
+        }
+        co_return buf.first(n);
+    }
+
+    // 正文是否已经读完（或者根本没有正文）
+    bool done() const noexcept { return mDone && mPending == 0; }
+
+    // 丢弃尚未读取的正文
+    Task<> drain() {
+        while (true) {
+            auto chunk = co_await read_some();
+            if (chunk.empty()) {
+                break;
+            }
+        }
+    }
+
+  private:
+    // 返回未读区开头的一行（不含换行符），mLineLength 为连同换行符的长度，尚未消耗。
+    // chunk 大小行或尾部字段超过流缓冲区的容量时视为格式错误
+    Task<std::string_view> readLine() {
+        std::size_t scanned = 0;
+        while (true) {
+            auto buf = mStream.peek();
+            if (buf.size() > scanned) {
+                if (auto* p = static_cast<char const*>(std::memchr(buf.data() + scanned, '\n', buf.size() - scanned))) {
+                    std::size_t n = p - buf.data();
+                    mLineLength = n + 1;
+                    co_return std::string_view(buf.data(), n && buf[n - 1] == '\r' ? n - 1 : n);
+                }
+            }
+            scanned = buf.size();
+            if (buf.size() >= mStream.ensure_limit()) [[unlikely]] {
+                throw HttpError(400, "chunk line too long");
+            }
+            co_await mStream.ensure(buf.size() + 1);
+        }
+    }
+
+    // chunk 数据之后的换行
+    Task<> expectLine() {
+        auto line = co_await readLine();
+        if (!line.empty()) [[unlikely]] {
+            throw HttpError(400, "malformed chunk terminator");
+        }
+        mStream.consume(mLineLength);
+    }
+
+    Stream& mStream;
+    std::uint64_t mRemaining = 0;
+    std::size_t mPending = 0;
+    std::size_t mLineLength = 0;
+    bool mChunked = false;
+    bool mUntilClose = false;
+    bool mFirstChunk = true;
+    bool mDone = true;
+};
+
+// 按请求头部设置正文解码方式；Transfer-Encoding 优先于 Content-Length
+template <class Stream>
+inline void httpSetupBody(HttpBodyDecoder<Stream>& body, std::span<HttpHeader const> headers) {
+    if (auto te = httpFindHeader(headers, "transfer-encoding"); !te.empty()) {
+        if (!httpHasToken(te, "chunked")) [[unlikely]] {
+            throw HttpError(501, "unsupported transfer encoding");
+        }
+        body.reset_chunked();
+    } else if (auto cl = httpFindHeader(headers, "content-length"); !cl.empty()) {
+        std::uint64_t length = 0;
+        auto [ptr, ec] = std::from_chars(cl.data(), cl.data() + cl.size(), length);
+        if (ec != std::errc() || ptr != cl.data() + cl.size()) [[unlikely]] {
+            throw HttpError(400, "invalid content length");
+        }
+        body.reset_length(length);
+    } else {
+        body.reset_length(0);
+    }
+}
+
+// 以 chunked 编码写出一段正文
+template <class Stream>
+Task<> httpWriteChunk(Stream& stream, std::string_view chunk) {
+    char size[20];
+    auto [ptr, ec] = std::to_chars(size, size + sizeof size - 2, chunk.size(), 16);
+    *ptr++ = '\r';
+    *ptr++ = '\n';
+    co_await stream.puts(std::string_view(size, ptr - size));
+    co_await stream.puts(chunk);
+    co_await stream.puts("\r\n");
+}
+
+// HTTP/1.1 服务器：按方法和路径注册处理函数，serve() 处理一条连接上的全部请求。
+// 连接默认保持（HTTP/1.0 需要 Connection: keep-alive）；缓冲区中已经到达的后续请求（流水线）
+// 依次处理，它们的响应由自动 flush 合并写出。空闲超过 idle timeout 的连接被关闭
+struct HttpServer {
+    // 处理函数可以读取请求正文，返回响应；抛出的异常以 500 回复（HttpError 按其状态码回复）
+    using Handler = std::function<Task<HttpResponse>(HttpRequest& request)>;
+
+    static constexpr std::size_t kLowWatermark = 64 * 1024;
+    static constexpr std::size_t kHighWatermark = 1024 * 1024;
+
+    void add_route(std::string method, std::string path, Handler handler) {
+        mRoutes.insert_or_assign(std::move(method) + ' ' + std::move(path), std::move(handler));
+    }
+
+    // 等待下一条请求的头部到齐的最长时间，零表示不限
+    void set_idle_timeout(std::chrono::system_clock::duration timeout) noexcept { mIdleTimeout = timeout; }
+
+    // 请求头部的长度上限（不超过流缓冲区的容量），超过时以 431 回复并关闭连接
+    void set_max_head_size(std::size_t size) noexcept { mMaxHeadSize = size; }
+
+    template <class Stream>
+    Task<> serve(EpollLoop& loop, TimerLoop& timer, Stream& stream) {
+        stream.set_auto_flush(loop);
+        stream.set_watermarks(kLowWatermark, kHighWatermark);
+        HttpBodyDecoder<Stream> body(stream);
+        HttpRequest request;
+        request.mBody = &body;
+        HttpHeadScanner scanner;
+        std::string head;
+        while (true) {
+            HttpResponse response;
+            bool keepAlive = false;
+            bool headOnly = false;
+            try {
+                // 流水线中的后续请求往往已在缓冲区中，此时不必设置定时器
+                std::size_t headLen = scanner.feed(stream.peek());
+                if (headLen == 0) {
+                    if (mIdleTimeout.count() > 0) {
+                        auto res = co_await limit_timeout(timer, waitHead(stream, scanner), mIdleTimeout);
+                        if (!res) {
+                            break;
+                        }
+                        headLen = *res;
+                    } else {
+                        headLen = co_await waitHead(stream, scanner);
+                    }
+                    if (headLen == 0) {
+                        break; // 在两条请求之间关闭连接
+                    }
+                }
+                // 直接在读缓冲区上解析；读取正文会移动缓冲区，所以有正文时才把头部复制出来
+                std::string_view inPlace(stream.peek().data(), headLen);
+                httpParseRequestHead(inPlace, request);
+                httpSetupBody(body, request.mHeaders);
+                std::size_t unconsumed = headLen;
+                if (!body.done()) {
+                    head.assign(inPlace);
+                    stream.consume(std::exchange(unconsumed, 0));
+                    httpParseRequestHead(head, request);
+                }
+                auto connection = request.header("connection");
+                keepAlive = request.mVersionMinor >= 1 ? !httpHasToken(connection, "close")
+                                                       : httpHasToken(connection, "keep-alive");
+                headOnly = request.mMethod == "HEAD";
+                if (httpHasToken(request.header("expect"), "100-continue") && request.mVersionMinor >= 1) {
+                    co_await stream.puts("HTTP/1.1 100 Continue\r\n\r\n");
+                }
+                response = co_await dispatch(request);
+                stream.consume(unconsumed);
+                co_await body.drain();
+            } catch (HttpError const& e) {
+                response = errorResponse(e.mStatus, e.what());
+                keepAlive = false;
+            } catch (EOFException const&) {
+                break;
+            }
+            try {
+                co_await stream.writable();
+                co_await writeResponse(stream, response, request.mVersionMinor, keepAlive, headOnly);
+            } catch (...) {
+                break;
+            }
+            if (!keepAlive) {
+                break;
+            }
+        }
+        try {
+            co_await stream.flush();
+        } catch (...) {
+        }
+    }
+
+  private:
+    static HttpResponse errorResponse(int status, std::string_view message) {
+        HttpResponse response;
+        response.mStatus = status;
+        response.mHeaders.emplace_back("content-type", "text/plain");
+        response.mBody.assign(message);
+        response.mBody.push_back('\n');
+        return response;
+    }
+
+    Task<HttpResponse> dispatch(HttpRequest& request) {
+        std::string key;
+        key.reserve(request.mMethod.size() + 1 + request.mTarget.size());
+        key.append(request.mMethod);
+        key.push_back(' ');
+        key.append(request.path());
+        auto it = mRoutes.find(key);
+        if (it == mRoutes.end() && request.mMethod == "HEAD") {
+            it = mRoutes.find("GET " + std::string(request.path()));
+        }
+        if (it == mRoutes.end()) {
+            co_return errorResponse(404, "not found");
+        }
+        try {
+            co_return co_await it->second(request);
+        } catch (HttpError const&) {
+            throw;
+        } catch (std::exception const& e) {
+            co_return errorResponse(500, e.what());
+        }
+    }
+
+    // 等待头部到齐，返回头部长度；连接在两条请求之间关闭时返回 0
+    template <class Stream>
+    Task<std::size_t> waitHead(Stream& stream, HttpHeadScanner& scanner) {
+        std::size_t limit = std::min(mMaxHeadSize, stream.ensure_limit());
+        while (true) {
+            auto buf = stream.peek();
+            if (buf.size() >= limit) [[unlikely]] {
+                throw HttpError(431, "request header too large");
+            }
+            try {
+                buf = co_await stream.ensure(buf.size() + 1);
+            } catch (EOFException const&) {
+                if (stream.peek().empty()) {
+                    co_return 0;
+                }
+                throw;
+            }
+            if (std::size_t n = scanner.feed(buf)) {
+                co_return n;
+            }
+        }
+    }
+
+    template <class Stream>
+    static Task<> writeResponse(Stream& stream, HttpResponse& response, int versionMinor, bool& keepAlive,
+                                bool headOnly) {
+        // 1xx、204、304 响应没有正文，也不带 content-length（RFC 9110 §8.6）：
+        // 304 的 content-length 描述的是未发送的表示，只能由处理函数给出
+        int status = response.mStatus;
+        if (status < 200 || status == 204 || status == 304) {
+            headOnly = true;
+            response.mBodyStream = {};
+        }
+        bool streaming = static_cast<bool>(response.mBodyStream);
+        // HTTP/1.0 不支持 chunked：流式正文写完后以关闭连接表示结束
+        bool chunked = streaming && versionMinor >= 1;
+        // HEAD 的处理函数可以自己给出 content-length（正文为空），此时不再按 mBody 补一个
+        auto isLength = [](auto const& h) { return httpNameEquals(h.first, "content-length"); };
+        bool lengthGiven = headOnly && std::any_of(response.mHeaders.begin(), response.mHeaders.end(), isLength);
+        bool sendLength = !streaming && !lengthGiven && status >= 200 && status != 204 && status != 304;
+        if (streaming && !chunked) {
+            keepAlive = false;
+        }
+        co_await stream.print("HTTP/1.1 ", response.mStatus, ' ', httpReasonPhrase(response.mStatus), "\r\n");
+        for (auto const& [name, value] : response.mHeaders) {
+            co_await stream.print(name, ": ", value, "\r\n");
+        }
+        if (chunked) {
+            co_await stream.puts("transfer-encoding: chunked\r\n");
+        } else if (sendLength) {
+            co_await stream.print("content-length: ", response.mBody.size(), "\r\n");
+        }
+        if (!keepAlive) {
+            co_await stream.puts("connection: close\r\n");
+        } else if (versionMinor == 0) {
+            co_await stream.puts("connection: keep-alive\r\n");
+        }
+        co_await stream.puts("\r\n");
+        if (headOnly) {
+            co_return;
+        }
+        if (!streaming) {
+            co_await stream.puts(response.mBody);
+            co_return;
+        }
+        while (auto chunk = co_await response.mBodyStream) {
+            if (chunk->empty()) {
+                continue;
+            }
+            co_await stream.writable();
+            if (chunked) {
+                co_await httpWriteChunk(stream, *chunk);
+            } else {
+                co_await stream.puts(*chunk);
+            }
+        }
+        if (chunked) {
+            co_await stream.puts("0\r\n\r\n");
+        }
+    }
+
+    std::unordered_map<std::string, Handler> mRoutes;
+    std::chrono::system_clock::duration mIdleTimeout = std::chrono::seconds(60);
+    std::size_t mMaxHeadSize = 64 * 1024;
+};
+
+} // namespace co_async
@@ -0,0 +1,474 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "generator.hpp"
+#include "http.hpp"
+#include "http_parser.hpp"
+#include "socket.hpp"
+#include "stream.hpp"
+#include "task.hpp"
+#include "wait_queue.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace co_async {
+
+struct HttpConnectionBase;
+
+// 客户端收到的响应。头部各字段指向响应自己保存的头部副本；
+// 正文须读完（或丢弃响应对象）后，同一连接上排在后面的响应才能读取
+struct HttpClientResponse : HttpResponseHead {
+    HttpClientResponse() = default;
+    HttpClientResponse(HttpClientResponse&& that) noexcept
+        : HttpResponseHead(std::move(that)),
+          mRawHead(std::move(that.mRawHead)),
+          mConnection(std::exchange(that.mConnection, nullptr)) {}
+    HttpClientResponse& operator=(HttpClientResponse&& that) noexcept {
+        if (this != &that) {
+            release();
+            HttpResponseHead::operator=(std::move(that));
+            mRawHead = std::move(that.mRawHead);
+            mConnection = std::exchange(that.mConnection, nullptr);
+        }
+        return *this;
+    }
+    ~HttpClientResponse() { release(); }
+
+    // 正文只能读取一次，read_body() 与 body_stream() 二选一
+    Task<std::string> read_body();
+    Generator<std::string> body_stream();
+
+  private:
+    friend struct HttpConnectionBase;
+
+    void release() noexcept;
+
+    // 头部副本；vector 移动时不搬移数据（std::string 的短字符串优化会），各字段的视图保持有效
+    std::vector<char> mRawHead;
+    HttpConnectionBase* mConnection = nullptr; // 正文尚未读完时指向所在连接
+};
+
+// 一条连接上的请求流水线：请求一发出就写入缓冲区，由自动 flush 合并写出；
+// 响应按发出顺序读取，每个请求等到轮到自己时才读响应头，正文由调用者直接从读缓冲区取走。
+// 与 Stream 类型无关的排队逻辑放在这里，HttpConnection<Stream> 负责读写
+struct HttpConnectionBase {
+    HttpConnectionBase() = default;
+    HttpConnectionBase(HttpConnectionBase&&) = delete;
+
+    // 还能否在这条连接上发出新请求：未出错，且对方没有要求关闭
+    bool is_reusable() const noexcept { return !mError && !mClosing; }
+
+    // 已发出但响应（含正文）尚未读完的请求数
+    std::size_t outstanding() const noexcept { return mSent - mTurn; }
+
+    // 是否还有响应对象指向这条连接
+    bool has_attached_response() const noexcept { return mAttached; }
+
+    // 已完整读取过响应的请求数
+    std::uint64_t completed() const noexcept { return mTurn; }
+
+  protected:
+    friend struct HttpClientResponse;
+
+    // deque 两端的插入删除不会移动其他元素，等待者可以一直挂在自己的 mReady 上
+    struct Slot {
+        bool mHeadRequest = false; // HEAD 请求的响应没有正文
+        bool mAbandoned = false;   // 调用者在拿到响应前被销毁（如超时取消）
+        WaitQueue mReady;          // 轮到这个请求时唤醒
+    };
+
+    // 等待轮到 seq 读取响应；调用者在拿到响应前被销毁时由 ~TurnGuard 让出位置
+    struct TurnGuard {
+        HttpConnectionBase* mConnection;
+        std::uint64_t mSeq;
+        bool mDone = false;
+
+        TurnGuard(HttpConnectionBase* connection, std::uint64_t seq) noexcept : mConnection(connection), mSeq(seq) {}
+        TurnGuard(TurnGuard&&) = delete;
+        ~TurnGuard() {
+            if (!mDone) {
+                mConnection->abandon(mSeq);
+            }
+        }
+    };
+
+    std::uint64_t pushSlot(bool headRequest) {
+        mSlots.emplace_back().mHeadRequest = headRequest;
+        return mSent++;
+    }
+
+    // 出错后不再维护队列，fail() 唤醒等待者的过程中队列也就不会变化
+    void abandon(std::uint64_t seq) {
+        if (mError) {
+            return;
+        }
+        if (seq != mTurn) {
+            mSlots[seq - mTurn].mAbandoned = true;
+            return;
+        }
+        // 正轮到它：它的响应由下一个读取者读出并丢弃
+        mSkipped.push_back(mSlots.front().mHeadRequest);
+        advanceTurn();
+    }
+
+    // 当前响应读完或被放弃，轮到下一个请求；之前被放弃的请求的响应留给下一个读取者丢弃
+    void advanceTurn() {
+        mSlots.pop_front();
+        ++mTurn;
+        while (!mSlots.empty() && mSlots.front().mAbandoned) {
+            mSkipped.push_back(mSlots.front().mHeadRequest);
+            mSlots.pop_front();
+            ++mTurn;
+        }
+        if (!mSlots.empty()) {
+            mSlots.front().mReady.notify_one();
+        }
+    }
+
+    // 正文读完或响应被丢弃；没读完的正文由下一个读取者跳过
+    void releaseResponse(bool bodyDone) {
+        mAttached = false;
+        if (mError) {
+            return;
+        }
+        mDrainPending = !bodyDone;
+        advanceTurn();
+    }
+
+    // 响应的正文由调用者读取，读完或丢弃响应时才轮到下一个请求
+    void attach(HttpClientResponse& response) noexcept {
+        response.mConnection = this;
+        mAttached = true;
+    }
+
+    static std::vector<char>& rawHead(HttpClientResponse& response) noexcept { return response.mRawHead; }
+
+    void fail(std::exception_ptr error) {
+        if (mError) {
+            return;
+        }
+        mError = error;
+        for (std::size_t i = 0; i < mSlots.size(); ++i) {
+            mSlots[i].mReady.notify_all();
+        }
+    }
+
+    HttpRequest::BodyReader* mBody = nullptr;
+    std::uint64_t mSent = 0;
+    std::uint64_t mTurn = 0;  // 正在或即将读取响应的请求序号
+    std::deque<Slot> mSlots;  // 序号在 [mTurn, mSent) 内的请求
+    std::deque<bool> mSkipped; // 响应需要读出并丢弃的请求（是否为 HEAD）
+    bool mDrainPending = false;
+    bool mBodyDone = true; // 当前读取者的正文是否已经读完
+    bool mClosing = false;
+    bool mAttached = false;
+    std::exception_ptr mError;
+};
+
+inline void HttpClientResponse::release() noexcept {
+    if (auto* connection = std::exchange(mConnection, nullptr)) {
+        connection->releaseResponse(connection->mBodyDone);
+    }
+}
+
+inline Task<std::string> HttpClientResponse::read_body() {
+    std::string body;
+    if (!mConnection) {
+        co_return body;
+    }
+    auto* connection = mConnection;
+    try {
+        while (true) {
+            auto chunk = co_await connection->mBody->read_some();
+            if (chunk.empty()) {
+                break;
+            }
+            body.append(chunk.data(), chunk.size());
+        }
+    } catch (...) {
+        connection->fail(std::current_exception());
+        throw;
+    }
+    connection->mBodyDone = true;
+    release();
+    co_return body;
+}
+
+inline Generator<std::string> HttpClientResponse::body_stream() {
+    if (!mConnection) {
+        co_return;
+    }
+    auto* connection = mConnection;
+    while (true) {
+        std::span<char const> chunk;
+        try {
+            chunk = co_await connection->mBody->read_some();
+        } catch (...) {
+            connection->fail(std::current_exception());
+            throw;
+        }
+        if (chunk.empty()) {
+            break;
+        }
+        co_yield std::string(chunk.data(), chunk.size());
+    }
+    connection->mBodyDone = true;
+    release();
+}
+
+// HTTP/1.1 客户端连接。多个协程可以同时在一条连接上发请求（流水线），各自按顺序拿到响应；
+// 连接出错或关闭时，所有未完成和之后的请求都抛出同一个异常。连接须比它发出的响应对象活得更久
+template <class Stream>
+struct HttpConnection : HttpConnectionBase {
+    static constexpr std::size_t kLowWatermark = 64 * 1024;
+    static constexpr std::size_t kHighWatermark = 1024 * 1024;
+
+    // host 为每个请求的 Host 头部
+    HttpConnection(EpollLoop& loop, Stream& stream, std::string host)
+        : mStream(stream),
+          mDecoder(stream),
+          mHost(std::move(host)) {
+        stream.set_auto_flush(loop);
+        stream.set_watermarks(kLowWatermark, kHighWatermark);
+        mBody = &mDecoder;
+    }
+
+    // 发出请求并等待响应头部，正文通过响应对象读取。body 非空（或方法不是 GET、HEAD）时带 Content-Length
+    Task<HttpClientResponse> request(std::string_view method, std::string_view target,
+                                     std::span<HttpHeader const> headers = {}, std::string_view body = {}) {
+        if (mError) [[unlikely]] {
+            std::rethrow_exception(mError);
+        }
+        if (mClosing) [[unlikely]] {
+            throw std::system_error(ECONNRESET, std::system_category(), "http connection closing");
+        }
+        co_await mStream.writable();
+        // 无界缓冲模式下写入不会挂起：整条请求连同排队位置一次完成，顺序与响应一致
+        co_await writeRequest(method, target, headers, body);
+        TurnGuard guard(this, pushSlot(method == "HEAD"));
+        while (mTurn != guard.mSeq && !mError) {
+            co_await mSlots[guard.mSeq - mTurn].mReady.wait();
+        }
+        if (mError) [[unlikely]] {
+            std::rethrow_exception(mError);
+        }
+        HttpClientResponse response;
+        try {
+            if (mDrainPending || !mSkipped.empty()) [[unlikely]] {
+                co_await skipPending();
+            }
+            co_await readResponse(response, method == "HEAD");
+        } catch (EOFException const&) {
+            fail(std::make_exception_ptr(
+                std::system_error(ECONNRESET, std::system_category(), "http connection closed")));
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        if (mError) [[unlikely]] {
+            std::rethrow_exception(mError);
+        }
+        guard.mDone = true;
+        mBodyDone = mDecoder.done();
+        if (mBodyDone) {
+            releaseResponse(true); // 没有正文，后面的请求不必等调用者
+        } else {
+            attach(response);
+        }
+        co_return response;
+    }
+
+    Task<HttpClientResponse> get(std::string_view target, std::span<HttpHeader const> headers = {}) {
+        return request("GET", target, headers);
+    }
+
+  private:
+    // 头部先拼在 mHeadBuf 中再一次写出，省去逐段写入的协程调用
+    Task<> writeRequest(std::string_view method, std::string_view target, std::span<HttpHeader const> headers,
+                        std::string_view body) {
+        mHeadBuf.clear();
+        mHeadBuf.append(method).append(" ").append(target).append(" HTTP/1.1\r\n");
+        if (!mHost.empty()) {
+            mHeadBuf.append("host: ").append(mHost).append("\r\n");
+        }
+        for (auto const& h : headers) {
+            mHeadBuf.append(h.mName).append(": ").append(h.mValue).append("\r\n");
+        }
+        if (!body.empty() || (method != "GET" && method != "HEAD")) {
+            char size[20];
+            auto [ptr, ec] = std::to_chars(size, size + sizeof size, body.size());
+            mHeadBuf.append("content-length: ").append(size, ptr).append("\r\n");
+        }
+        mHeadBuf.append("\r\n");
+        co_await mStream.puts(mHeadBuf);
+        if (!body.empty()) {
+            co_await mStream.puts(body);
+        }
+    }
+
+    // 读出前一个响应没读完的正文，以及被放弃的请求的整条响应
+    Task<> skipPending() {
+        if (mDrainPending) {
+            co_await mDecoder.drain();
+            mDrainPending = false;
+        }
+        while (!mSkipped.empty()) {
+            HttpClientResponse discarded;
+            co_await readResponse(discarded, mSkipped.front());
+            co_await mDecoder.drain();
+            mSkipped.pop_front();
+        }
+    }
+
+    // 读取响应头部（跳过 1xx 临时响应）并按 RFC 9112 第 6.3 节确定正文长度
+    Task<> readResponse(HttpClientResponse& response, bool headRequest) {
+        while (true) {
+            std::size_t headLen;
+            while (!(headLen = mScanner.feed(mStream.peek()))) {
+                co_await mStream.ensure(mStream.peek().size() + 1);
+            }
+            auto buf = mStream.peek();
+            auto& raw = rawHead(response);
+            raw.assign(buf.data(), buf.data() + headLen);
+            mStream.consume(headLen);
+            httpParseResponseHead(std::string_view(raw.data(), headLen), response);
+            if (response.mStatus >= 200 || response.mStatus == 101) {
+                break;
+            }
+        }
+        auto connection = response.header("connection");
+        if (response.mVersionMinor >= 1 ? httpHasToken(connection, "close")
+                                        : !httpHasToken(connection, "keep-alive")) {
+            mClosing = true;
+        }
+        int status = response.mStatus;
+        if (headRequest || status < 200 || status == 204 || status == 304) {
+            mDecoder.reset_length(0);
+        } else if (!response.header("transfer-encoding").empty() || !response.header("content-length").empty()) {
+            httpSetupBody(mDecoder, response.mHeaders);
+        } else {
+            mDecoder.reset_until_close();
+            mClosing = true;
+        }
+    }
+
+    Stream& mStream;
+    HttpBodyDecoder<Stream> mDecoder;
+    HttpHeadScanner mScanner;
+    std::string mHost;
+    std::string mHeadBuf;
+};
+
+// 对同一服务器的连接池，须比它返回的响应对象活得更久。请求分给积压最少的连接，所有连接都忙且未达上限时建立新连接，
+// 达到上限后在已有连接上流水线发送。对方关闭的连接在空闲后移除；
+// 复用的空闲连接恰好被对方关闭时（如对方的空闲超时），幂等请求换一条连接重试
+struct HttpClient {
+    HttpClient(EpollLoop& loop, SocketAddress address, std::string host, std::size_t maxConnections = 4)
+        : mLoop(loop),
+          mAddress(address),
+          mHost(std::move(host)),
+          mMaxConnections(maxConnections) {}
+    HttpClient(HttpClient&&) = delete;
+
+    Task<HttpClientResponse> request(std::string_view method, std::string_view target,
+                                     std::span<HttpHeader const> headers = {}, std::string_view body = {}) {
+        bool idempotent = method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" ||
+                          method == "OPTIONS";
+        while (true) {
+            Connection* connection = co_await pick();
+            bool reused = connection->mHttp.completed() != 0;
+            ++connection->mUsers;
+            try {
+                auto response = co_await connection->mHttp.request(method, target, headers, body);
+                --connection->mUsers;
+                co_return response;
+            } catch (std::system_error const& e) {
+                --connection->mUsers;
+                // 失败的连接已不可复用，重试会换到别的连接上；新建的连接失败时不再重试
+                if (!(e.code() == std::errc::connection_reset && reused && idempotent)) {
+                    throw;
+                }
+            } catch (...) {
+                --connection->mUsers;
+                throw;
+            }
+        }
+    }
+
+    Task<HttpClientResponse> get(std::string_view target, std::span<HttpHeader const> headers = {}) {
+        return request("GET", target, headers);
+    }
+
+    std::size_t connection_count() const noexcept { return mConnections.size(); }
+
+  private:
+    struct Connection {
+        FileStream mStream;
+        HttpConnection<FileStream> mHttp;
+        std::size_t mUsers = 0; // 正在此连接上发请求的调用者，发出前连接不能移除
+
+        Connection(EpollLoop& loop, AsyncFile file, std::string const& host)
+            : mStream(loop, std::move(file)),
+              mHttp(loop, mStream, host) {}
+    };
+
+    // 只有可复用的连接计入上限；达到上限时若连接都还在建立中，等建立完成后再选
+    Task<Connection*> pick() {
+        while (true) {
+            std::erase_if(mConnections, [](auto const& c) {
+                return !c->mHttp.is_reusable() && c->mUsers == 0 && !c->mHttp.has_attached_response();
+            });
+            Connection* best = nullptr;
+            std::size_t usable = mConnecting;
+            for (auto& c : mConnections) {
+                if (c->mHttp.is_reusable()) {
+                    ++usable;
+                    if (!best || c->mHttp.outstanding() < best->mHttp.outstanding()) {
+                        best = c.get();
+                    }
+                }
+            }
+            bool full = usable >= mMaxConnections;
+            if (best && (best->mHttp.outstanding() == 0 || full)) {
+                co_return best;
+            }
+            if (!full) {
+                break;
+            }
+            co_await mConnected.wait();
+        }
+        ++mConnecting;
+        AsyncFile sock;
+        try {
+            sock = co_await create_tcp_client(mLoop, mAddress);
+        } catch (...) {
+            --mConnecting;
+            mConnected.notify_all();
+            throw;
+        }
+        --mConnecting;
+        socketSetOption<int>(sock, IPPROTO_TCP, TCP_NODELAY, 1);
+        auto* c = mConnections.emplace_back(std::make_unique<Connection>(mLoop, std::move(sock), mHost)).get();
+        mConnected.notify_all();
+        co_return c;
+    }
+
+    EpollLoop& mLoop;
+    SocketAddress mAddress;
+    std::string mHost;
+    std::size_t mMaxConnections;
+    std::size_t mConnecting = 0;
+    WaitQueue mConnected; // 连接数已达上限、又都在建立中时在此等待
+    std::vector<std::unique_ptr<Connection>> mConnections;
+};
+
+} // namespace co_async
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace co_async {
+
+// HTTP/1.x 头部解析，直接在流缓冲区上进行，结果均为指向输入的 string_view。
+// 热点是寻找头部结尾和扫描头部值（常见的长值如 Cookie、User-Agent）：
+// 前者一次比较 32（AVX2）或 16（SSE2）字节，后者用 AVX2 或 SSE4.2 的 pcmpestri 找第一个控制字符；
+// 编译时不要求 -mavx2 / -msse4.2，运行时检测处理器支持后选用，否则退回逐字节扫描
+
+// 请求格式错误等需要以特定状态码回复的错误
+struct HttpError : std::runtime_error {
+    int mStatus;
+
+    HttpError(int status, char const* what) : std::runtime_error(what), mStatus(status) {}
+};
+
+struct HttpHeader {
+    std::string_view mName;
+    std::string_view mValue;
+};
+
+// 头部名称不区分大小写
+inline bool httpNameEquals(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if ((a[i] | 0x20) != (b[i] | 0x20)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline std::string_view httpFindHeader(std::span<HttpHeader const> headers, std::string_view name) noexcept {
+    for (auto const& h : headers) {
+        if (httpNameEquals(h.mName, name)) {
+            return h.mValue;
+        }
+    }
+    return {};
+}
+
+struct HttpRequestHead {
+    std::string_view mMethod;
+    std::string_view mTarget; // 路径和查询串
+    int mVersionMinor = 1;    // HTTP/1.x 中的 x
+    std::vector<HttpHeader> mHeaders;
+
+    std::string_view header(std::string_view name) const noexcept { return httpFindHeader(mHeaders, name); }
+    std::string_view path() const noexcept { return mTarget.substr(0, mTarget.find('?')); }
+};
+
+struct HttpResponseHead {
+    int mStatus = 0;
+    std::string_view mReason;
+    int mVersionMinor = 1;
+    std::vector<HttpHeader> mHeaders;
+
+    std::string_view header(std::string_view name) const noexcept { return httpFindHeader(mHeaders, name); }
+};
+
+// RFC 9110 的 tchar：方法和头部名称只能由这些字符组成
+inline constexpr std::array<bool, 256> kHttpTokenChar = [] {
+    std::array<bool, 256> table{};
+    for (int c = '0'; c <= '9'; ++c) {
+        table[c] = true;
+    }
+    for (int c = 'a'; c <= 'z'; ++c) {
+        table[c] = table[c - 'a' + 'A'] = true;
+    }
+    for (char c : std::string_view("!#$%&'*+-.^_`|~")) {
+        table[static_cast<unsigned char>(c)] = true;
+    }
+    return table;
+}();
+
+enum class HttpSimdLevel {
+    Scalar,
+    Sse42,
+    Avx2,
+};
+
+inline HttpSimdLevel httpSimdLevel() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    static HttpSimdLevel const level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return HttpSimdLevel::Avx2;
+        }
+        if (__builtin_cpu_supports("sse4.2")) {
+            return HttpSimdLevel::Sse42;
+        }
+        return HttpSimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return HttpSimdLevel::Scalar;
+#endif
+}
+
+// 头部结尾：一个换行之后紧跟空行（\r\n 或 \n）。p 处的换行判断需要看到其后的两个字节
+inline bool httpIsHeadEnd(char const* p, char const* end) noexcept {
+    return p[0] == '\n' && end - p >= 2 && (p[1] == '\n' || (p[1] == '\r' && end - p >= 3 && p[2] == '\n'));
+}
+
+inline std::size_t httpHeadEndAt(char const* begin, char const* p) noexcept {
+    return p - begin + (p[1] == '\n' ? 2 : 3);
+}
+
+inline std::size_t httpFindHeadEndScalar(char const* begin, char const* p, char const* end) noexcept {
+    while (p < end) {
+        p = static_cast<char const*>(std::memchr(p, '\n', end - p));
+        if (!p) {
+            break;
+        }
+        if (httpIsHeadEnd(p, end)) {
+            return httpHeadEndAt(begin, p);
+        }
+        ++p;
+    }
+    return 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 同时比较相邻的三个偏移：位置 i 为换行，且 i+1 为换行、或 i+1、i+2 为 \r\n
+__attribute__((target("avx2"))) inline std::size_t httpFindHeadEndAvx2(char const* begin, char const* p,
+                                                                       char const* end) noexcept {
+    __m256i const nl = _mm256_set1_epi8('\n');
+    __m256i const cr = _mm256_set1_epi8('\r');
+    for (; end - p >= 34; p += 32) {
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 1));
+        __m256i b2 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 2));
+        __m256i hit = _mm256_and_si256(
+            _mm256_cmpeq_epi8(b0, nl),
+            _mm256_or_si256(_mm256_cmpeq_epi8(b1, nl), _mm256_and_si256(_mm256_cmpeq_epi8(b1, cr),
+                                                                        _mm256_cmpeq_epi8(b2, nl))));
+        if (auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hit))) {
+            return httpHeadEndAt(begin, p + __builtin_ctz(mask));
+        }
+    }
+    return httpFindHeadEndScalar(begin, p, end);
+}
+
+inline std::size_t httpFindHeadEndSse2(char const* begin, char const* p, char const* end) noexcept {
+    __m128i const nl = _mm_set1_epi8('\n');
+    __m128i const cr = _mm_set1_epi8('\r');
+    for (; end - p >= 18; p += 16) {
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 1));
+        __m128i b2 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 2));
+        __m128i hit = _mm_and_si128(
+            _mm_cmpeq_epi8(b0, nl),
+            _mm_or_si128(_mm_cmpeq_epi8(b1, nl), _mm_and_si128(_mm_cmpeq_epi8(b1, cr), _mm_cmpeq_epi8(b2, nl))));
+        if (auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(hit))) {
+            return httpHeadEndAt(begin, p + __builtin_ctz(mask));
+        }
+    }
+    return httpFindHeadEndScalar(begin, p, end);
+}
+#endif
+
+// 在 buf 中从 from 处开始寻找头部结尾，返回头部长度（含结尾的空行），未找到时返回 0
+inline std::size_t httpFindHeadEnd(std::span<char const> buf, std::size_t from = 0) noexcept {
+    char const* begin = buf.data();
+    char const* p = begin + from;
+    char const* end = begin + buf.size();
+#if defined(__x86_64__) || defined(__i386__)
+    if (httpSimdLevel() == HttpSimdLevel::Avx2) [[likely]] {
+        return httpFindHeadEndAvx2(begin, p, end);
+    }
+    return httpFindHeadEndSse2(begin, p, end);
+#else
+    return httpFindHeadEndScalar(begin, p, end);
+#endif
+}
+
+// 头部字段值与请求目标中不允许出现的字符：除 HT 外的控制字符和 DEL；stopAtSpace 时空格也算在内
+inline bool httpIsCtl(unsigned char c, bool stopAtSpace) noexcept {
+    return (c < 0x20 && c != '\t') || c == 0x7F || (stopAtSpace && c == ' ');
+}
+
+inline char const* httpFindCtlScalar(char const* p, char const* end, bool stopAtSpace) noexcept {
+    while (p < end && !httpIsCtl(static_cast<unsigned char>(*p), stopAtSpace)) {
+        ++p;
+    }
+    return p;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) inline char const* httpFindCtlAvx2(char const* p, char const* end,
+                                                                   bool stopAtSpace) noexcept {
+    __m256i const limit = _mm256_set1_epi8(0x1F);
+    __m256i const tab = _mm256_set1_epi8('\t');
+    __m256i const del = _mm256_set1_epi8(0x7F);
+    __m256i const space = _mm256_set1_epi8(stopAtSpace ? ' ' : 0x7F);
+    for (; end - p >= 32; p += 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+        // 无符号比较 b <= 0x1F
+        __m256i ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(b, tab), _mm256_cmpeq_epi8(_mm256_min_epu8(b, limit), b));
+        __m256i hit = _mm256_or_si256(ctl, _mm256_or_si256(_mm256_cmpeq_epi8(b, del), _mm256_cmpeq_epi8(b, space)));
+        if (auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hit))) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return httpFindCtlScalar(p, end, stopAtSpace);
+}
+
+// pcmpestri 的范围比较：返回 16 字节中第一个落在任一 [lo, hi] 区间内的字节下标，没有则返回 16
+__attribute__((target("sse4.2"))) inline char const* httpFindCtlSse42(char const* p, char const* end,
+                                                                      bool stopAtSpace) noexcept {
+    alignas(16) static char const kRanges[16] = "\x00\x08\x0a\x1f\x7f\x7f";
+    alignas(16) static char const kRangesSpace[16] = "\x00\x08\x0a\x20\x7f\x7f";
+    __m128i ranges = _mm_load_si128(reinterpret_cast<__m128i const*>(stopAtSpace ? kRangesSpace : kRanges));
+    for (; end - p >= 16; p += 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        int i = _mm_cmpestri(ranges, 6, b, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (i != 16) {
+            return p + i;
+        }
+    }
+    return httpFindCtlScalar(p, end, stopAtSpace);
+}
+#endif
+
+// 返回 [p, end) 中第一个控制字符的位置，没有时返回 end
+inline char const* httpFindCtl(char const* p, char const* end, bool stopAtSpace) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (httpSimdLevel()) {
+    case HttpSimdLevel::Avx2: return httpFindCtlAvx2(p, end, stopAtSpace);
+    case HttpSimdLevel::Sse42: return httpFindCtlSse42(p, end, stopAtSpace);
+    case HttpSimdLevel::Scalar: break;
+    }
+#endif
+    return httpFindCtlScalar(p, end, stopAtSpace);
+}
+
+inline char const* httpParseTokenScalar(char const* p, char const* end) noexcept {
+    while (p < end && kHttpTokenChar[static_cast<unsigned char>(*p)]) {
+        ++p;
+    }
+    return p;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 用 pshufb 按高低半字节查表判断 tchar：tchar 的高半字节只有 2~7，各占一位，
+// 低半字节表的第 h-2 位表示字符 (h << 4 | l) 是否为 tchar，两次查表结果相与非零即为 tchar
+inline constexpr std::array<char, 32> kHttpTokenNibbles = [] {
+    std::array<char, 32> lut{};
+    for (int c = 0; c < 256; ++c) {
+        if (kHttpTokenChar[c]) {
+            lut[c & 0x0F] = static_cast<char>(lut[c & 0x0F] | (1 << ((c >> 4) - 2)));
+        }
+    }
+    for (int h = 2; h < 8; ++h) {
+        lut[16 + h] = static_cast<char>(1 << (h - 2));
+    }
+    return lut;
+}();
+
+__attribute__((target("avx2"))) inline char const* httpParseTokenAvx2(char const* p, char const* end) noexcept {
+    __m256i const lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(kHttpTokenNibbles.data())));
+    __m256i const hi =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(kHttpTokenNibbles.data() + 16)));
+    __m256i const nibble = _mm256_set1_epi8(0x0F);
+    for (; end - p >= 32; p += 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+        __m256i cls = _mm256_and_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(b, nibble)),
+                                       _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble)));
+        auto mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cls, _mm256_setzero_si256())));
+        if (mask != ~std::uint32_t(0)) {
+            return p + __builtin_ctz(~mask);
+        }
+    }
+    return httpParseTokenScalar(p, end);
+}
+
+__attribute__((target("sse4.2"))) inline char const* httpParseTokenSse42(char const* p, char const* end) noexcept {
+    __m128i const lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(kHttpTokenNibbles.data()));
+    __m128i const hi = _mm_loadu_si128(reinterpret_cast<__m128i const*>(kHttpTokenNibbles.data() + 16));
+    __m128i const nibble = _mm_set1_epi8(0x0F);
+    for (; end - p >= 16; p += 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        __m128i cls = _mm_and_si128(_mm_shuffle_epi8(lo, _mm_and_si128(b, nibble)),
+                                    _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(b, 4), nibble)));
+        if (auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(cls, _mm_setzero_si128())))) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return httpParseTokenScalar(p, end);
+}
+#endif
+
+// 返回 [p, end) 中第一个不是 tchar 的字符的位置，没有时返回 end
+inline char const* httpParseToken(char const* p, char const* end) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (httpSimdLevel()) {
+    case HttpSimdLevel::Avx2: return httpParseTokenAvx2(p, end);
+    case HttpSimdLevel::Sse42: return httpParseTokenSse42(p, end);
+    case HttpSimdLevel::Scalar: break;
+    }
+#endif
+    return httpParseTokenScalar(p, end);
+}
+
+// 以下解析函数的输入都是 httpFindHeadEnd 确认过的完整头部，一定以空行结尾，扫描不会越界
+
+// 跳过 \r\n 或 \n，不是换行时抛出 HttpError
+inline char const* httpParseEol(char const* p, char const* end, char const* what) {
+    if (p < end && *p == '\n') {
+        return p + 1;
+    }
+    if (end - p >= 2 && p[0] == '\r' && p[1] == '\n') {
+        return p + 2;
+    }
+    throw HttpError(400, what);
+}
+
+inline char const* httpParseVersion(char const* p, char const* end, int& minor) {
+    if (end - p < 8 || std::memcmp(p, "HTTP/1.", 7) != 0 || p[7] < '0' || p[7] > '9') [[unlikely]] {
+        throw HttpError(400, "invalid http version");
+    }
+    minor = p[7] - '0';
+    return p + 8;
+}
+
+// 解析头部字段直到空行
+inline void httpParseHeaderLines(char const* p, char const* end, std::vector<HttpHeader>& headers) {
+    headers.clear();
+    while (true) {
+        if (*p == '\n') {
+            return;
+        }
+        if (*p == '\r') {
+            httpParseEol(p, end, "malformed http header");
+            return;
+        }
+        char const* nameEnd = httpParseToken(p, end);
+        if (nameEnd == p || nameEnd == end || *nameEnd != ':') [[unlikely]] {
+            throw HttpError(400, "malformed http header"); // 包括名称与冒号之间有空白、obs-fold 续行
+        }
+        char const* value = nameEnd + 1;
+        while (*value == ' ' || *value == '\t') {
+            ++value;
+        }
+        char const* valueEnd = httpFindCtl(value, end, false);
+        char const* next = httpParseEol(valueEnd, end, "malformed http header");
+        while (valueEnd != value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+            --valueEnd;
+        }
+        headers.push_back({std::string_view(p, nameEnd - p), std::string_view(value, valueEnd - value)});
+        p = next;
+    }
+}
+
+// head 为完整的请求头部（含结尾的空行）。请求行之前的空行被忽略
+inline void httpParseRequestHead(std::string_view head, HttpRequestHead& req) {
+    char const* p = head.data();
+    char const* end = p + head.size();
+    while (p < end && (*p == '\r' || *p == '\n')) {
+        ++p;
+    }
+    char const* methodEnd = httpParseToken(p, end);
+    if (methodEnd == p || methodEnd == end || *methodEnd != ' ') [[unlikely]] {
+        throw HttpError(400, "malformed http request line");
+    }
+    req.mMethod = std::string_view(p, methodEnd - p);
+    char const* target = methodEnd + 1;
+    char const* targetEnd = httpFindCtl(target, end, true);
+    if (targetEnd == target || targetEnd == end || *targetEnd != ' ') [[unlikely]] {
+        throw HttpError(400, "malformed http request line");
+    }
+    req.mTarget = std::string_view(target, targetEnd - target);
+    p = httpParseVersion(targetEnd + 1, end, req.mVersionMinor);
+    p = httpParseEol(p, end, "malformed http request line");
+    httpParseHeaderLines(p, end, req.mHeaders);
+}
+
+// head 为完整的响应头部（含结尾的空行）
+inline void httpParseResponseHead(std::string_view head, HttpResponseHead& res) {
+    char const* p = head.data();
+    char const* end = p + head.size();
+    p = httpParseVersion(p, end, res.mVersionMinor);
+    if (end - p < 5 || p[0] != ' ' || p[1] < '1' || p[1] > '9' || p[2] < '0' || p[2] > '9' || p[3] < '0' ||
+        p[3] > '9') [[unlikely]] {
+        throw HttpError(400, "malformed http status line");
+    }
+    res.mStatus = (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+    p += 4;
+    char const* reason = p;
+    if (*p == ' ') {
+        reason = p + 1;
+        p = httpFindCtl(reason, end, false);
+    }
+    res.mReason = std::string_view(reason, p - reason);
+    p = httpParseEol(p, end, "malformed http status line");
+    httpParseHeaderLines(p, end, res.mHeaders);
+}
+
+// 增量地寻找头部结尾：每次传入从头部起始处开始、比上次更长的未读区，
+// 已经扫描过的部分不再重复扫描（只回退两个字节，以免漏掉跨越两次读取的换行）
+struct HttpHeadScanner {
+    // 返回头部长度；尚不完整时返回 0。找到后自动复位，可用于下一个头部
+    std::size_t feed(std::span<char const> buf) noexcept {
+        std::size_t n = httpFindHeadEnd(buf, std::min(mScanned, buf.size()));
+        mScanned = n ? 0 : (buf.size() >= 2 ? buf.size() - 2 : 0);
+        return n;
+    }
+
+    void reset() noexcept { mScanned = 0; }
+
+  private:
+    std::size_t mScanned = 0;
+};
+
+} // namespace co_async
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "buffer_pool.hpp"
+
+#include <cstddef>
+
+namespace co_async {
+
+// 内嵌在流对象中的定长缓冲区：容量是编译期常量，边界检查和 memcpy 长度对优化器可见；
+// 流对象放在栈上或协程帧里时不需要任何堆分配，适合短生命周期的请求解析器
+template <std::size_t N>
+struct InlineBuffer {
+    static_assert(N > 0, "InlineBuffer capacity must be positive");
+
+    static constexpr bool kMirrored = false;
+    static constexpr std::size_t kDefaultSize = N;
+
+    // 容量固定为 N，参数只为与其他存储的构造方式保持一致
+    explicit InlineBuffer(std::size_t = N) noexcept {}
+
+    char* data() noexcept { return mData; }
+    char const* data() const noexcept { return mData; }
+    static constexpr std::size_t size() noexcept { return N; }
+    static constexpr bool allocated() noexcept { return true; }
+    char& operator[](std::size_t i) noexcept { return mData[i]; }
+    char operator[](std::size_t i) const noexcept { return mData[i]; }
+
+    void acquire(BufferPool&) noexcept {}
+    void release() noexcept {}
+
+  private:
+    char mData[N];
+};
+
+} // namespace co_async
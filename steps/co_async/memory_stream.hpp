@@ -0,0 +1,105 @@
+#pragma once
+
+#include "buffer_pool.hpp"
+#include "error_handling.hpp"
+#include "stream_base.hpp"
+
+#include <cstddef>
+#include <fcntl.h>
+#include <span>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace co_async {
+
+// 不拥有内存的视图存储：直接把外部数据当作 IStreamBase 的缓冲区，数据只读，不会被写入
+struct ViewBuffer {
+    static constexpr bool kMirrored = false;
+    static constexpr bool kView = true;
+
+    explicit ViewBuffer(std::span<char const> data) noexcept
+        : mData(const_cast<char*>(data.data())),
+          mSize(data.size()) {}
+
+    char* data() const noexcept { return mData; }
+    std::size_t size() const noexcept { return mSize; }
+    bool allocated() const noexcept { return true; }
+    char& operator[](std::size_t i) const noexcept { return mData[i]; }
+
+    void acquire(BufferPool&) noexcept {}
+    void release() noexcept {}
+
+  private:
+    char* mData;
+    std::size_t mSize;
+};
+
+// 只读映射一个普通文件作为视图存储，析构时解除映射
+struct MappedBuffer {
+    static constexpr bool kMirrored = false;
+    static constexpr bool kView = true;
+
+    explicit MappedBuffer(const char* path) {
+        int fd = checkError(open(path, O_RDONLY | O_CLOEXEC));
+        try {
+            struct stat st;
+            checkError(fstat(fd, &st));
+            mSize = st.st_size;
+            // 空文件无法建立映射，视为空数据
+            if (mSize) {
+                void* p = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) [[unlikely]] {
+                    checkError(-1);
+                }
+                mData = static_cast<char*>(p);
+                // 提示内核按顺序预读，读过的页可以尽早回收
+                madvise(mData, mSize, MADV_SEQUENTIAL);
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+    }
+    MappedBuffer(MappedBuffer&& that) noexcept
+        : mData(std::exchange(that.mData, nullptr)),
+          mSize(std::exchange(that.mSize, 0)) {}
+    MappedBuffer& operator=(MappedBuffer&& that) noexcept {
+        std::swap(mData, that.mData);
+        std::swap(mSize, that.mSize);
+        return *this;
+    }
+    ~MappedBuffer() {
+        if (mData) {
+            munmap(mData, mSize);
+        }
+    }
+
+    char* data() const noexcept { return mData; }
+    std::size_t size() const noexcept { return mSize; }
+    bool allocated() const noexcept { return true; }
+    char& operator[](std::size_t i) const noexcept { return mData[i]; }
+
+    void acquire(BufferPool&) noexcept {}
+    void release() noexcept {}
+
+  private:
+    char* mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+// 以内存中的一段数据为源的输入流：缓冲区就是数据本身，读取时没有任何复制，读完即 EOF。
+// 数据的生命周期由调用者保证
+struct [[nodiscard]] MemoryIStream : IStreamBase<MemoryIStream, ViewBuffer> {
+    MemoryIStream() noexcept : MemoryIStream(std::span<char const>()) {}
+    explicit MemoryIStream(std::span<char const> data) : IStreamBase(ViewBuffer(data)) {}
+};
+
+// 以只读映射的文件为源的输入流，解析本地大文件时只有扫描本身的开销
+struct [[nodiscard]] MmapIStream : IStreamBase<MmapIStream, MappedBuffer> {
+    explicit MmapIStream(const char* path) : IStreamBase(MappedBuffer(path)) {}
+};
+
+} // namespace co_async
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "buffer_pool.hpp"
+#include "error_handling.hpp"
+
+#include <cstddef>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+namespace co_async {
+
+// 双重映射的环形缓冲区：同一块 memfd 内存在虚拟地址上首尾相接映射两次，
+// 因此任意起点开始、长度不超过容量的区间 [p, p + size()) 总是连续可访问的。
+// 作为 IStreamBase 的存储时，读取只填充空闲区，未读数据永远是一段连续内存，无需搬移
+struct MirroredBuffer {
+    static constexpr bool kMirrored = true;
+    static constexpr std::size_t kDefaultSize = 65536;
+
+    explicit MirroredBuffer(std::size_t size = kDefaultSize) noexcept : mSize(roundToPage(size)) {}
+    MirroredBuffer(MirroredBuffer&& that) noexcept : mData(std::exchange(that.mData, nullptr)), mSize(that.mSize) {}
+    MirroredBuffer& operator=(MirroredBuffer&& that) noexcept {
+        std::swap(mData, that.mData);
+        std::swap(mSize, that.mSize);
+        return *this;
+    }
+    ~MirroredBuffer() {
+        if (mData) {
+            munmap(mData, mSize * 2);
+        }
+    }
+
+    char* data() const noexcept { return mData; }
+    std::size_t size() const noexcept { return mSize; }
+    bool allocated() const noexcept { return mData != nullptr; }
+    char& operator[](std::size_t i) const noexcept { return mData[i]; }
+
+    void acquire(BufferPool&) {
+        if (mData) {
+            return;
+        }
+        int fd = checkError(memfd_create("co_async_ring", MFD_CLOEXEC));
+        try {
+            checkError(ftruncate(fd, mSize));
+            // 先预留连续的两倍地址空间，再把同一块内存固定映射到前后两半
+            void* base = mmap(nullptr, mSize * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) [[unlikely]] {
+                checkError(-1);
+            }
+            char* p = static_cast<char*>(base);
+            if (mmap(p, mSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+                mmap(p + mSize, mSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+                [[unlikely]] {
+                int err = errno;
+                munmap(base, mSize * 2);
+                errno = err;
+                checkError(-1);
+            }
+            mData = p;
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+    }
+
+    // 建立映射的代价较高，映射一直保留到析构；因此 IOStream 的输出侧不使用本存储
+    void release() noexcept {}
+
+  private:
+    static std::size_t roundToPage(std::size_t size) noexcept {
+        std::size_t page = sysconf(_SC_PAGESIZE);
+        return size == 0 ? page : (size + page - 1) / page * page;
+    }
+
+    char* mData = nullptr;
+    std::size_t mSize;
+};
+
+} // namespace co_async
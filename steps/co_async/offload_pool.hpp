@@ -0,0 +1,238 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "error_handling.hpp"
+#include "task.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <sys/eventfd.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace co_async {
+
+struct OffloadPool;
+
+// 交给线程池执行的一项阻塞操作：run() 在工作线程中执行，complete() 回到 loop 线程后执行
+struct OffloadJob {
+    virtual void run() = 0;
+    virtual void complete() = 0;
+
+  protected:
+    ~OffloadJob() = default;
+
+  private:
+    friend struct OffloadPool;
+
+    std::atomic<bool> mDone{false};
+};
+
+// 把会阻塞的系统调用（普通文件的 pread/pwrite、fdatasync 等）放到工作线程中执行，
+// 完成后经 eventfd 唤醒 loop，由 loop 线程依次执行各项的 complete()。
+// 有操作未完成时 loop 上挂着一个等待 eventfd 的协程，loop 不会提前退出
+struct OffloadPool {
+    explicit OffloadPool(EpollLoop& loop, std::size_t threads = 4)
+        : mLoop(loop),
+          mEventFile(checkError(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
+        for (std::size_t i = 0; i < threads; ++i) {
+            mThreads.emplace_back([this] { worker(); });
+        }
+    }
+    OffloadPool(OffloadPool&&) = delete;
+    ~OffloadPool() {
+        if (mPumpAlive) {
+            // 在某项的 complete() 中被析构（如等待者恢复后销毁了 pool）：pump 返回后自行释放协程帧
+            *mPumpAlive = false;
+            mPumpTask.mHandle = nullptr;
+        }
+        {
+            std::lock_guard lock(mMutex);
+            mStop = true;
+        }
+        mJobReady.notify_all();
+        for (auto& thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    EpollLoop& loop() const noexcept { return mLoop; }
+
+    void submit(OffloadJob& job) {
+        job.mDone.store(false, std::memory_order_relaxed);
+        {
+            std::lock_guard lock(mMutex);
+            mJobs.push_back(&job);
+        }
+        mJobReady.notify_one();
+        if (mPending++ == 0 && !mPumping) {
+            mPumping = true;
+            mPumpTask = pump();
+            spawn_task(mPumpTask);
+        }
+    }
+
+    // 在 loop 线程上撤销一项已提交、尚未 complete() 的操作：还在排队则直接移除，
+    // 已在执行则等它执行完（阻塞 loop 线程），之后不会再调用它的 complete()。
+    // 返回 true 表示 run() 从未执行
+    bool cancel(OffloadJob& job) {
+        bool queued;
+        {
+            std::lock_guard lock(mMutex);
+            queued = eraseJob(mJobs, &job);
+        }
+        if (!queued) {
+            job.mDone.wait(false);
+            std::lock_guard lock(mMutex);
+            eraseJob(mCompleted, &job);
+        }
+        if (--mPending == 0) {
+            wakeLoop(); // 让等待 eventfd 的协程退出
+        }
+        return queued;
+    }
+
+  private:
+    static bool eraseJob(std::deque<OffloadJob*>& jobs, OffloadJob* job) {
+        auto it = std::find(jobs.begin(), jobs.end(), job);
+        if (it == jobs.end()) {
+            return false;
+        }
+        jobs.erase(it);
+        return true;
+    }
+
+    void wakeLoop() noexcept {
+        std::uint64_t one = 1;
+        (void)!write(mEventFile.fileNo(), &one, sizeof one);
+    }
+
+    void worker() {
+        while (true) {
+            OffloadJob* job;
+            {
+                std::unique_lock lock(mMutex);
+                mJobReady.wait(lock, [this] { return mStop || !mJobs.empty(); });
+                if (mStop) {
+                    return;
+                }
+                job = mJobs.front();
+                mJobs.pop_front();
+            }
+            job->run();
+            {
+                // 在锁内置位并通知：cancel() 拿到锁之前，job 不会被销毁
+                std::lock_guard lock(mMutex);
+                mCompleted.push_back(job);
+                job->mDone.store(true);
+                job->mDone.notify_all();
+            }
+            wakeLoop();
+        }
+    }
+
+    Task<> pump() {
+        while (mPending) {
+            co_await wait_file_event(mLoop, mEventFile, EPOLLIN);
+            std::uint64_t count;
+            (void)!read(mEventFile.fileNo(), &count, sizeof count);
+            // 每次只取一项：complete() 可能撤销队列中的其他项
+            while (true) {
+                OffloadJob* job;
+                {
+                    std::lock_guard lock(mMutex);
+                    if (mCompleted.empty()) {
+                        break;
+                    }
+                    job = mCompleted.front();
+                    mCompleted.pop_front();
+                }
+                --mPending;
+                bool alive = true;
+                mPumpAlive = &alive;
+                job->complete();
+                if (!alive) [[unlikely]] {
+                    co_await DestroySelf();
+                }
+                mPumpAlive = nullptr;
+            }
+        }
+        mPumping = false;
+    }
+
+    EpollLoop& mLoop;
+    AsyncFile mEventFile;
+    std::mutex mMutex;
+    std::condition_variable mJobReady;
+    std::deque<OffloadJob*> mJobs;
+    std::deque<OffloadJob*> mCompleted;
+    bool mStop = false;
+    std::vector<std::thread> mThreads;
+    std::size_t mPending = 0; // 已提交、尚未 complete() 的操作数，只在 loop 线程上访问
+    bool mPumping = false;
+    bool* mPumpAlive = nullptr; // pump 正在执行 complete() 时指向它的存活标志
+    Task<> mPumpTask;
+};
+
+// co_await pool.run(func)：在工作线程中执行 func，挂起当前协程直到完成。
+// func 在工作线程中留下的 errno 会带回 loop 线程，便于随后 checkError
+template <class F>
+struct [[nodiscard]] OffloadAwaiter : OffloadJob {
+    using Result = std::invoke_result_t<F&>;
+    static_assert(!std::is_void_v<Result>, "offloaded function must return a value");
+
+    OffloadAwaiter(OffloadPool& pool, F func) : mPool(pool), mFunc(std::move(func)) {}
+    OffloadAwaiter(OffloadAwaiter&&) = delete;
+    // 等待中的协程被销毁时，等到工作线程不再访问 func 引用的数据为止
+    ~OffloadAwaiter() {
+        if (mSubmitted) {
+            mPool.cancel(*this);
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> coroutine) {
+        mCoroutine = coroutine;
+        mSubmitted = true;
+        mPool.submit(*this);
+    }
+    Result await_resume() {
+        errno = mErrno;
+        return std::move(*mResult);
+    }
+
+  private:
+    void run() override {
+        mResult.emplace(mFunc());
+        mErrno = errno;
+    }
+
+    void complete() override {
+        mSubmitted = false;
+        mCoroutine.resume();
+    }
+
+    OffloadPool& mPool;
+    F mFunc;
+    std::optional<Result> mResult;
+    int mErrno = 0;
+    bool mSubmitted = false;
+    std::coroutine_handle<> mCoroutine;
+};
+
+template <class F>
+OffloadAwaiter<F> offload(OffloadPool& pool, F func) {
+    return OffloadAwaiter<F>(pool, std::move(func));
+}
+
+} // namespace co_async
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "task.hpp"
+#include "wait_queue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace co_async {
+
+// 进程内单向管道：定长环形缓冲区，读者在空时等待，写者在满时等待。
+// 不经过内核，供同一 loop 内的两个协程互相通信。
+// 等待者就地唤醒，一问一答的双方可能永远不必回到 loop：读写连续 kInlineLimit 次不需等待时让出一次，
+// 否则未优化的构建中（对称转移不是尾调用）栈会随每次往返加深
+struct PipeRing {
+    // 容量为 0 时既不能写入也不能读出，两端都会永远等待，因此直接拒绝
+    PipeRing(EpollLoop& loop, std::size_t capacity)
+        : mLoop(loop),
+          mData(std::make_unique_for_overwrite<char[]>(checkCapacity(capacity))),
+          mCapacity(capacity) {}
+    PipeRing(PipeRing&&) = delete;
+
+    // 等到有数据可读或写端已关闭
+    Task<> waitReadable() {
+        while (mSize == 0 && !mClosed) {
+            mReadInline = 0;
+            co_await mNotEmpty.wait();
+        }
+    }
+
+    // 返回 0 表示写端已关闭且数据已读完
+    Task<std::size_t> read(std::span<char> buffer) {
+        co_await waitReadable();
+        std::size_t len = std::min(buffer.size(), mSize);
+        std::size_t first = std::min(len, mCapacity - mHead);
+        std::memcpy(buffer.data(), mData.get() + mHead, first);
+        std::memcpy(buffer.data() + first, mData.get(), len - first);
+        mHead = (mHead + len) % mCapacity;
+        mSize -= len;
+        mNotFull.notify_all();
+        if (inlineLimitReached(mReadInline)) {
+            co_await mLoop.yield();
+        }
+        co_return len;
+    }
+
+    // 至少写入一个字节才返回；读端已关闭时抛出 EPIPE
+    Task<std::size_t> write(std::span<char const> buffer) {
+        while (mSize == mCapacity && !mClosed) {
+            mWriteInline = 0;
+            co_await mNotFull.wait();
+        }
+        if (mClosed) [[unlikely]] {
+            throw std::system_error(EPIPE, std::system_category());
+        }
+        std::size_t len = std::min(buffer.size(), mCapacity - mSize);
+        std::size_t tail = (mHead + mSize) % mCapacity;
+        std::size_t first = std::min(len, mCapacity - tail);
+        std::memcpy(mData.get() + tail, buffer.data(), first);
+        std::memcpy(mData.get(), buffer.data() + first, len - first);
+        mSize += len;
+        mNotEmpty.notify_all();
+        if (inlineLimitReached(mWriteInline)) {
+            co_await mLoop.yield();
+        }
+        co_return len;
+    }
+
+    // 任一端关闭后，读者读完剩余数据得到 EOF，写者得到 EPIPE
+    void close() {
+        mClosed = true;
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+  private:
+    static constexpr unsigned kInlineLimit = 64;
+
+    static std::size_t checkCapacity(std::size_t capacity) {
+        if (capacity == 0) [[unlikely]] {
+            throw std::invalid_argument("pipe capacity must be positive");
+        }
+        return capacity;
+    }
+
+    static bool inlineLimitReached(unsigned& count) noexcept {
+        if (++count < kInlineLimit) {
+            return false;
+        }
+        count = 0;
+        return true;
+    }
+
+    EpollLoop& mLoop;
+    std::unique_ptr<char[]> mData;
+    std::size_t mCapacity;
+    std::size_t mHead = 0;
+    std::size_t mSize = 0;
+    bool mClosed = false;
+    unsigned mReadInline = 0;  // 读端连续不需等待的次数
+    unsigned mWriteInline = 0; // 写端连续不需等待的次数
+    WaitQueue mNotEmpty;
+    WaitQueue mNotFull;
+};
+
+// 双工管道的一端：从一条 PipeRing 读，向另一条写，析构时关闭两个方向
+struct PipeBuf {
+    PipeBuf() noexcept {}
+    PipeBuf(std::shared_ptr<PipeRing> in, std::shared_ptr<PipeRing> out) noexcept
+        : mIn(std::move(in)),
+          mOut(std::move(out)) {}
+    PipeBuf(PipeBuf&&) = default;
+    PipeBuf& operator=(PipeBuf&& that) noexcept {
+        std::swap(mIn, that.mIn);
+        std::swap(mOut, that.mOut);
+        return *this;
+    }
+    ~PipeBuf() { close(); }
+
+    void close() {
+        if (mIn) {
+            std::exchange(mIn, nullptr)->close();
+        }
+        if (mOut) {
+            std::exchange(mOut, nullptr)->close();
+        }
+    }
+
+    // 数据到达后才让 IStreamBase 申请缓冲区
+    Task<> waitRead() { return mIn->waitReadable(); }
+
+    Task<std::size_t> read(std::span<char> buffer) { return mIn->read(buffer); }
+
+    Task<std::size_t> write(std::span<char const> buffer) { return mOut->write(buffer); }
+
+  private:
+    std::shared_ptr<PipeRing> mIn;
+    std::shared_ptr<PipeRing> mOut;
+};
+
+// 创建一对互相连接的管道端点，每个方向各有 capacity 字节的缓冲
+inline std::pair<PipeBuf, PipeBuf> make_pipe(EpollLoop& loop, std::size_t capacity = 65536) {
+    auto forward = std::make_shared<PipeRing>(loop, capacity);
+    auto backward = std::make_shared<PipeRing>(loop, capacity);
+    return {PipeBuf(forward, backward), PipeBuf(backward, forward)};
+}
+
+} // namespace co_async
@@ -211,62 +211,121 @@ struct RbTree {
     /*     } */
     /* } */
 
+    // 用 v 替换 u 在父节点中的位置
+    void transplant(RbNode* u, RbNode* v) noexcept {
+        if (u->parent == nullptr) {
+            root = v;
+        } else if (u == u->parent->left) {
+            u->parent->left = v;
+        } else {
+            u->parent->right = v;
+        }
+        if (v != nullptr) {
+            v->parent = u->parent;
+        }
+    }
+
     void doErase(RbNode* current) noexcept {
         current->tree = nullptr;
 
-        RbNode* node = nullptr;
-        RbNode* child = nullptr;
-        RbColor color = RED;
-
-        if (current->left != nullptr && current->right != nullptr) {
-            RbNode* replace = current;
-            replace = replace->right;
+        // child 顶替被移走的节点，可能为空，因此单独记下它的父节点
+        RbNode* child;
+        RbNode* parent;
+        RbColor color = current->color;
+
+        if (current->left == nullptr) {
+            child = current->right;
+            parent = current->parent;
+            transplant(current, current->right);
+        } else if (current->right == nullptr) {
+            child = current->left;
+            parent = current->parent;
+            transplant(current, current->left);
+        } else {
+            // 两个子节点：用右子树的最小节点接替 current 的位置和颜色
+            RbNode* replace = current->right;
             while (replace->left != nullptr) {
                 replace = replace->left;
             }
-
-            if (current != replace->parent) {
-                current->parent->left = replace->right;
-                replace->right = current->right;
-                current->right->parent = replace;
-            } else {
-                replace->parent = current;
-            }
-
-            if (current == root) {
-                root = replace;
-            } else if (current->parent->left == current) {
-                current->parent->left = replace;
+            color = replace->color;
+            child = replace->right;
+            if (replace->parent == current) {
+                parent = replace;
             } else {
-                current->parent->right = replace;
+                parent = replace->parent;
+                transplant(replace, replace->right);
+                replace->right = current->right;
+                replace->right->parent = replace;
             }
-
+            transplant(current, replace);
             replace->left = current->left;
-            current->left->parent = replace;
-
-            node = replace;
-            color = node->color;
-            child = node->right;
-        } else {
-            node = current;
-            color = node->color;
-            child = (node->left != nullptr) ? node->left : node->right;
+            replace->left->parent = replace;
+            replace->color = current->color;
         }
 
-        if (child != nullptr) {
-            child->parent = node->parent;
+        if (color == BLACK) {
+            fixErase(child, parent);
         }
+    }
 
-        if (node == root) {
-            root = child;
-        } else if (node->parent->left == node) {
-            node->parent->left = child;
-        } else {
-            node->parent->right = child;
+    // 删除黑色节点后，child 所在的一侧少了一个黑色节点
+    void fixErase(RbNode* node, RbNode* parent) noexcept {
+        auto isBlack = [](RbNode* n) { return n == nullptr || n->color == BLACK; };
+        while (node != root && isBlack(node)) {
+            if (node == parent->left) {
+                RbNode* sibling = parent->right;
+                if (sibling->color == RED) {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    rotateLeft(parent);
+                    sibling = parent->right;
+                }
+                if (isBlack(sibling->left) && isBlack(sibling->right)) {
+                    sibling->color = RED;
+                    node = parent;
+                    parent = node->parent;
+                } else {
+                    if (isBlack(sibling->right)) {
+                        sibling->left->color = BLACK;
+                        sibling->color = RED;
+                        rotateRight(sibling);
+                        sibling = parent->right;
+                    }
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+                    sibling->right->color = BLACK;
+                    rotateLeft(parent);
+                    node = root;
+                }
+            } else {
+                RbNode* sibling = parent->left;
+                if (sibling->color == RED) {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    rotateRight(parent);
+                    sibling = parent->left;
+                }
+                if (isBlack(sibling->left) && isBlack(sibling->right)) {
+                    sibling->color = RED;
+                    node = parent;
+                    parent = node->parent;
+                } else {
+                    if (isBlack(sibling->left)) {
+                        sibling->right->color = BLACK;
+                        sibling->color = RED;
+                        rotateLeft(sibling);
+                        sibling = parent->left;
+                    }
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+                    sibling->left->color = BLACK;
+                    rotateRight(parent);
+                    node = root;
+                }
+            }
         }
-
-        if (color == BLACK && root) {
-            fixViolation(child ? child : node->parent);
+        if (node != nullptr) {
+            node->color = BLACK;
         }
     }
 
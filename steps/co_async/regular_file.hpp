@@ -0,0 +1,286 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "error_handling.hpp"
+#include "offload_pool.hpp"
+#include "task.hpp"
+#include "wait_queue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <span>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace co_async {
+
+// 普通文件总是“就绪”，epoll 无法等待它们，读写磁盘时会阻塞整个 loop。
+// AsyncRegularFile 把 pread/pwrite/fdatasync 交给 OffloadPool 的工作线程执行
+struct [[nodiscard]] AsyncRegularFile {
+    AsyncRegularFile(OffloadPool& pool, AsyncFile file) noexcept : mPool(&pool), mFile(std::move(file)) {}
+    AsyncRegularFile(AsyncRegularFile&&) = default;
+    AsyncRegularFile& operator=(AsyncRegularFile&&) = default;
+
+    int fileNo() const noexcept { return mFile.fileNo(); }
+    OffloadPool& pool() const noexcept { return *mPool; }
+
+    std::size_t size() const {
+        struct stat st;
+        checkError(fstat(fileNo(), &st));
+        return st.st_size;
+    }
+
+    // 返回读到的字节数，0 表示已到文件末尾
+    Task<std::size_t> pread(off_t offset, std::span<char> buffer) {
+        int fd = fileNo();
+        auto res = co_await offload(*mPool, [&] { return ::pread(fd, buffer.data(), buffer.size(), offset); });
+        co_return checkError(res);
+    }
+
+    // 写完全部数据才返回
+    Task<std::size_t> pwrite(off_t offset, std::span<char const> buffer) {
+        int fd = fileNo();
+        auto res = co_await offload(*mPool, [&] { return writeAll(fd, offset, buffer); });
+        co_return checkError(res);
+    }
+
+    Task<> fdatasync() {
+        int fd = fileNo();
+        checkError(co_await offload(*mPool, [&] { return ::fdatasync(fd); }));
+    }
+
+    Task<> truncate(off_t length) {
+        int fd = fileNo();
+        checkError(co_await offload(*mPool, [&] { return ::ftruncate(fd, length); }));
+    }
+
+    static ssize_t writeAll(int fd, off_t offset, std::span<char const> buffer) noexcept {
+        std::size_t done = 0;
+        while (done < buffer.size()) {
+            ssize_t len = ::pwrite(fd, buffer.data() + done, buffer.size() - done, offset + done);
+            if (len == -1) {
+                return -1;
+            }
+            done += len;
+        }
+        return done;
+    }
+
+  private:
+    OffloadPool* mPool;
+    AsyncFile mFile;
+};
+
+// open 也可能因访问元数据而阻塞，同样放到工作线程中执行
+inline Task<AsyncRegularFile> open_regular_file(OffloadPool& pool, const char* path, int flags = O_RDONLY,
+                                                mode_t mode = 0644) {
+    int fd = checkError(co_await offload(pool, [&] { return ::open(path, flags | O_CLOEXEC, mode); }));
+    co_return AsyncRegularFile(pool, AsyncFile(fd));
+}
+
+// 以 AsyncRegularFile 为源/目的地的 StreamBuf，从 offset 开始顺序读写。
+// 预读：两块 readahead 大小的缓冲区轮流使用，消费一块时另一块已在后台读取下一段。
+// 延迟写入：写入先攒到 writeBehind 字节，再交给后台 pwrite，同时只有一次写在进行；
+// 用 sync() 等待全部写完（可选 fdatasync）。不支持在后台读写进行中移动
+struct RegularFileBuf {
+    RegularFileBuf(AsyncRegularFile file, off_t offset = 0) noexcept : mFile(std::move(file)), mOffset(offset) {}
+    RegularFileBuf(RegularFileBuf&&) = default;
+    // 移动赋值会覆盖目标尚未写出的延迟写入数据并取消其后台写入，因此不提供
+    RegularFileBuf& operator=(RegularFileBuf&&) = delete;
+    // 尚未写完的延迟写入数据在析构时同步写出，避免丢失：
+    // 先了结后台那次写入，再写攒着的部分，保证先后顺序
+    ~RegularFileBuf() {
+        if (mWriteJob) {
+            mWriteJob->finish();
+        }
+        if (!mStaging.empty()) {
+            (void)AsyncRegularFile::writeAll(mFile.fileNo(), mStagingOffset, mStaging);
+        }
+    }
+
+    // 0 表示关闭预读
+    void set_readahead(std::size_t bytes) { mReadahead = bytes; }
+
+    // 0 表示关闭延迟写入
+    void set_write_behind(std::size_t bytes) { mWriteBehind = bytes; }
+
+    off_t offset() const noexcept { return mOffset; }
+    AsyncRegularFile& file() noexcept { return mFile; }
+
+    Task<std::size_t> read(std::span<char> buffer) {
+        if (!mReadahead) {
+            std::size_t len = co_await mFile.pread(mOffset, buffer);
+            mOffset += len;
+            co_return len;
+        }
+        if (!mAhead[0]) {
+            mAhead[0] = std::make_unique<IoJob>(mFile.fileNo(), mReadahead);
+            mAhead[1] = std::make_unique<IoJob>(mFile.fileNo(), mReadahead);
+        }
+        IoJob* cur = mAhead[mCur].get();
+        if (!cur->mBusy && cur->available() == 0) {
+            // 当前块已读完，换到预读中的另一块；它的位置不对（如首次读取）时重新读取
+            IoJob* next = mAhead[mCur ^ 1].get();
+            if (next->mOffset != mOffset || (!next->mBusy && next->available() == 0)) {
+                co_await next->join();
+                next->submitRead(mFile.pool(), mOffset);
+            }
+            mCur ^= 1;
+            cur = next;
+        }
+        co_await cur->join();
+        std::size_t len = std::min(buffer.size(), cur->available());
+        if (len == 0) {
+            co_return 0;
+        }
+        std::memcpy(buffer.data(), cur->mData.get() + cur->mPos, len);
+        cur->mPos += len;
+        mOffset += len;
+        // 开始消费这一块时，另一块就去读紧随其后的下一段
+        IoJob* other = mAhead[mCur ^ 1].get();
+        if (!other->mBusy && other->mOffset != cur->end()) {
+            other->submitRead(mFile.pool(), cur->end());
+        }
+        co_return len;
+    }
+
+    Task<std::size_t> write(std::span<char const> buffer) {
+        if (!mWriteBehind) {
+            std::size_t len = co_await mFile.pwrite(mOffset, buffer);
+            mOffset += len;
+            co_return len;
+        }
+        if (mStaging.empty()) {
+            mStagingOffset = mOffset;
+        }
+        mStaging.insert(mStaging.end(), buffer.begin(), buffer.end());
+        mOffset += buffer.size();
+        if (mStaging.size() >= mWriteBehind) {
+            co_await submitStaging();
+        }
+        co_return buffer.size();
+    }
+
+    // 等待延迟写入的数据全部写出；durable 为真时再 fdatasync
+    Task<> sync(bool durable = false) {
+        if (!mStaging.empty()) {
+            co_await submitStaging();
+        }
+        if (mWriteJob) {
+            co_await mWriteJob->join();
+        }
+        if (durable) {
+            co_await mFile.fdatasync();
+        }
+    }
+
+  private:
+    // 后台的一次 pread/pwrite，完成后唤醒等待者
+    struct IoJob : OffloadJob {
+        IoJob(int fd, std::size_t capacity)
+            : mFd(fd),
+              mData(std::make_unique_for_overwrite<char[]>(capacity)),
+              mCapacity(capacity) {}
+        IoJob(IoJob&&) = delete;
+        ~IoJob() {
+            if (mBusy) {
+                mPool->cancel(*this);
+            }
+        }
+
+        std::size_t available() const noexcept { return mResult > 0 ? mResult - mPos : 0; }
+        off_t end() const noexcept { return mOffset + std::max<ssize_t>(mResult, 0); }
+
+        // 不经 loop 了结进行中的操作：还在排队的写入撤下来在当前线程写出，已在执行的等它写完
+        void finish() noexcept {
+            if (!mBusy) {
+                return;
+            }
+            mBusy = false;
+            if (mPool->cancel(*this) && mWrite) {
+                (void)AsyncRegularFile::writeAll(mFd, mOffset, std::span(mData.get(), mSize));
+            }
+        }
+
+        void submitRead(OffloadPool& pool, off_t offset) {
+            start(pool, offset, false, mCapacity);
+        }
+
+        void start(OffloadPool& pool, off_t offset, bool write, std::size_t size) {
+            mPool = &pool;
+            mOffset = offset;
+            mWrite = write;
+            mSize = size;
+            mResult = 0;
+            mPos = 0;
+            mBusy = true;
+            pool.submit(*this);
+        }
+
+        // 等待进行中的操作完成，并把它的错误抛给调用者
+        Task<> join() {
+            while (mBusy) {
+                co_await mDone.wait();
+            }
+            if (mResult == -1) [[unlikely]] {
+                mResult = 0;
+                errno = mErrno;
+                checkError(-1);
+            }
+        }
+
+        void run() override {
+            mResult = mWrite ? AsyncRegularFile::writeAll(mFd, mOffset, std::span(mData.get(), mSize))
+                             : ::pread(mFd, mData.get(), mSize, mOffset);
+            mErrno = errno;
+        }
+
+        void complete() override {
+            mBusy = false;
+            mDone.notify_all();
+        }
+
+        int mFd;
+        std::unique_ptr<char[]> mData;
+        std::size_t mCapacity;
+        OffloadPool* mPool = nullptr;
+        off_t mOffset = -1;
+        bool mWrite = false;
+        std::size_t mSize = 0;
+        ssize_t mResult = 0;
+        int mErrno = 0;
+        std::size_t mPos = 0;
+        bool mBusy = false;
+        WaitQueue mDone;
+    };
+
+    Task<> submitStaging() {
+        if (!mWriteJob || mWriteJob->mCapacity < mStaging.size()) {
+            if (mWriteJob) {
+                co_await mWriteJob->join();
+            }
+            mWriteJob = std::make_unique<IoJob>(mFile.fileNo(), std::max(mWriteBehind, mStaging.size()));
+        }
+        co_await mWriteJob->join();
+        std::memcpy(mWriteJob->mData.get(), mStaging.data(), mStaging.size());
+        mWriteJob->start(mFile.pool(), mStagingOffset, true, mStaging.size());
+        mStaging.clear();
+    }
+
+    AsyncRegularFile mFile;
+    off_t mOffset;
+    std::size_t mReadahead = 0;
+    std::size_t mWriteBehind = 0;
+    std::unique_ptr<IoJob> mAhead[2];
+    unsigned mCur = 0;
+    std::vector<char> mStaging;
+    off_t mStagingOffset = 0;
+    std::unique_ptr<IoJob> mWriteJob;
+};
+
+} // namespace co_async
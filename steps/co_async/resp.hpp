@@ -0,0 +1,419 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "stream_base.hpp"
+#include "task.hpp"
+#include "wait_queue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace co_async {
+
+// RESP2/RESP3 的值类型，枚举值即线路上的类型前缀字符
+enum class RespType : char {
+    SimpleString = '+',
+    Error = '-',
+    Integer = ':',
+    BulkString = '$',
+    Array = '*',
+    Null = '_',
+    Boolean = '#',
+    Double = ',',
+    BigNumber = '(',
+    BulkError = '!',
+    Verbatim = '=',
+    Map = '%',
+    Set = '~',
+    Push = '>',
+};
+
+struct RespValue {
+    RespType mType = RespType::Null;
+    std::string mString;              // 各种字符串、错误信息、大数
+    std::int64_t mInteger = 0;        // Integer；Boolean 为 0 或 1
+    double mDouble = 0;               // Double
+    std::vector<RespValue> mElements; // Array、Set、Push；Map 按 键、值 交替存放
+
+    bool is_null() const noexcept { return mType == RespType::Null; }
+    bool is_error() const noexcept { return mType == RespType::Error || mType == RespType::BulkError; }
+};
+
+// 服务器返回错误回复时由 RespClient::command() 抛出，what() 为错误信息
+struct RespError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// 命令参数：字符串或整数
+template <class T>
+concept RespArg = std::convertible_to<T const&, std::string_view> || (std::is_arithmetic_v<T> && !std::same_as<T, char>);
+
+// 返回未读区开头一行的长度（不含 \r\n），这一行仍留在缓冲区中
+template <class Stream>
+Task<std::size_t> respLineLength(Stream& stream) {
+    std::size_t scanned = 0;
+    while (true) {
+        auto buf = stream.peek();
+        auto* p = buf.size() > scanned
+                      ? static_cast<char const*>(std::memchr(buf.data() + scanned, '\n', buf.size() - scanned))
+                      : nullptr;
+        if (p) {
+            std::size_t n = p - buf.data();
+            if (n == 0 || buf[n - 1] != '\r') [[unlikely]] {
+                throw std::invalid_argument("malformed RESP line");
+            }
+            co_return n - 1;
+        }
+        scanned = buf.size();
+        co_await stream.ensure(buf.size() + 1);
+    }
+}
+
+inline std::int64_t respParseInteger(std::string_view s) {
+    std::int64_t value = 0;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc() || ptr != s.data() + s.size()) [[unlikely]] {
+        throw std::invalid_argument("malformed RESP integer");
+    }
+    return value;
+}
+
+// 读取一个完整的 RESP 值。行和批量字符串都直接从流缓冲区整段复制，不逐字节读取；
+// 超过缓冲区容量的批量字符串直接读入目标字符串。属性（|）被跳过
+template <class Stream>
+Task<RespValue> read_resp(Stream& stream) {
+    RespValue value;
+    while (true) {
+        std::size_t len = co_await respLineLength(stream);
+        if (len == 0) [[unlikely]] {
+            throw std::invalid_argument("malformed RESP value");
+        }
+        auto buf = stream.peek();
+        char type = buf[0];
+        auto line = std::string_view(buf.data() + 1, len - 1);
+        value.mType = static_cast<RespType>(type);
+        switch (type) {
+        case '+':
+        case '-':
+        case '(':
+            value.mString.assign(line);
+            stream.consume(len + 2);
+            co_return value;
+        case ':':
+            value.mInteger = respParseInteger(line);
+            stream.consume(len + 2);
+            co_return value;
+        case '_':
+            stream.consume(len + 2);
+            co_return value;
+        case '#':
+            value.mInteger = line == "t";
+            stream.consume(len + 2);
+            co_return value;
+        case ',': {
+            auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), value.mDouble);
+            // from_chars 同样接受 inf、-inf 和 nan
+            if (ec != std::errc() || ptr != line.data() + line.size()) [[unlikely]] {
+                throw std::invalid_argument("malformed RESP double");
+            }
+            stream.consume(len + 2);
+            co_return value;
+        }
+        case '$':
+        case '!':
+        case '=': {
+            std::int64_t size = respParseInteger(line);
+            stream.consume(len + 2);
+            if (size < 0) { // RESP2 的空批量字符串 $-1
+                value.mType = RespType::Null;
+                co_return value;
+            }
+            std::size_t n = size;
+            if (n + 2 <= stream.ensure_limit()) {
+                auto data = co_await stream.ensure(n + 2);
+                value.mString.assign(data.data(), n);
+                stream.consume(n + 2);
+            } else {
+                value.mString = co_await stream.getn(n);
+                co_await stream.ensure(2);
+                stream.consume(2);
+            }
+            co_return value;
+        }
+        case '*':
+        case '~':
+        case '>':
+        case '%':
+        case '|': {
+            std::int64_t count = respParseInteger(line);
+            stream.consume(len + 2);
+            if (count < 0) { // RESP2 的空数组 *-1
+                value.mType = RespType::Null;
+                co_return value;
+            }
+            if (type == '%' || type == '|') {
+                count *= 2;
+            }
+            std::vector<RespValue> elements;
+            elements.reserve(count);
+            for (std::int64_t i = 0; i < count; ++i) {
+                elements.push_back(co_await read_resp(stream));
+            }
+            if (type == '|') {
+                continue; // 属性只是附加信息，紧随其后的才是真正的值
+            }
+            value.mElements = std::move(elements);
+            co_return value;
+        }
+        default: throw std::invalid_argument("unknown RESP type");
+        }
+    }
+}
+
+// 按 RESP 格式写出一个值，供服务端（如测试用的假服务器）回复
+template <class Stream>
+Task<> write_resp(Stream& stream, RespValue const& value) {
+    char buf[32];
+    auto header = [&](char type, auto number) {
+        buf[0] = type;
+        auto [ptr, ec] = std::to_chars(buf + 1, buf + sizeof buf - 2, number);
+        *ptr++ = '\r';
+        *ptr++ = '\n';
+        return std::string_view(buf, ptr - buf);
+    };
+    switch (value.mType) {
+    case RespType::SimpleString:
+    case RespType::Error:
+    case RespType::BigNumber:
+        co_await stream.putchar(static_cast<char>(value.mType));
+        co_await stream.puts(value.mString);
+        co_await stream.puts("\r\n");
+        break;
+    case RespType::Integer: co_await stream.puts(header(':', value.mInteger)); break;
+    case RespType::Null: co_await stream.puts("_\r\n"); break;
+    case RespType::Boolean: co_await stream.puts(value.mInteger ? "#t\r\n" : "#f\r\n"); break;
+    case RespType::Double: co_await stream.puts(header(',', value.mDouble)); break;
+    case RespType::BulkString:
+    case RespType::BulkError:
+    case RespType::Verbatim:
+        co_await stream.puts(header(static_cast<char>(value.mType), value.mString.size()));
+        co_await stream.puts(value.mString);
+        co_await stream.puts("\r\n");
+        break;
+    case RespType::Map:
+        co_await stream.puts(header('%', value.mElements.size() / 2));
+        for (auto const& element : value.mElements) {
+            co_await write_resp(stream, element);
+        }
+        break;
+    default:
+        co_await stream.puts(header(static_cast<char>(value.mType), value.mElements.size()));
+        for (auto const& element : value.mElements) {
+            co_await write_resp(stream, element);
+        }
+        break;
+    }
+}
+
+// Redis 客户端。多个协程并发发出的命令在同一轮里写入缓冲区，由自动 flush 合并为一次写出；
+// 服务器按顺序回复，后台读协程依次把回复交给排队的调用者。
+// 连接出错或关闭时，所有未完成和之后的命令都抛出同一个异常
+template <class Stream>
+struct RespClient {
+    static constexpr std::size_t kLowWatermark = 64 * 1024;
+    static constexpr std::size_t kHighWatermark = 1024 * 1024;
+
+    RespClient(EpollLoop& loop, Stream& stream) : mStream(stream) {
+        stream.set_auto_flush(loop);
+        stream.set_watermarks(kLowWatermark, kHighWatermark);
+    }
+    RespClient(RespClient&&) = delete;
+    ~RespClient() {
+        for (auto* pending : mPending) {
+            if (pending) {
+                pending->mClient = nullptr;
+            }
+        }
+        if (mReaderAlive) {
+            // 在读协程唤醒调用者的途中被析构：读协程返回后自行释放协程帧
+            *mReaderAlive = false;
+            mReader.mHandle = nullptr;
+        }
+    }
+
+    // 参数可以是字符串或整数，如 command("SET", key, 42)，字符串须在命令完成前保持有效。错误回复抛出 RespError
+    template <RespArg... Args>
+        requires(sizeof...(Args) > 0)
+    Task<RespValue> command(Args const&... args) {
+        return commandArgs(toArg(args)...);
+    }
+
+    Task<RespValue> command(std::span<std::string const> args) {
+        std::vector<std::string_view> views(args.begin(), args.end());
+        co_return co_await commandImpl(views);
+    }
+
+  private:
+    // 整数参数转换后的文本存放在临时对象中，直到整条命令写完
+    struct Arg {
+        std::string_view mView;
+        std::size_t mLen = 0;
+        char mBuf[32];
+
+        std::string_view view() const noexcept { return mLen ? std::string_view(mBuf, mLen) : mView; }
+    };
+
+    template <class T>
+    static Arg toArg(T const& value) {
+        Arg arg;
+        if constexpr (std::convertible_to<T const&, std::string_view>) {
+            arg.mView = value;
+        } else {
+            auto [ptr, ec] = std::to_chars(arg.mBuf, arg.mBuf + sizeof arg.mBuf, value);
+            arg.mLen = ptr - arg.mBuf;
+        }
+        return arg;
+    }
+
+    template <std::same_as<Arg>... Ts>
+    Task<RespValue> commandArgs(Ts... args) {
+        std::string_view views[] = {args.view()...};
+        co_return co_await commandImpl(views);
+    }
+
+    struct PendingReply {
+        RespClient* mClient;
+        bool mCompleted = false;
+        RespValue mValue;
+        std::exception_ptr mError;
+        WaitQueue mDone;
+
+        explicit PendingReply(RespClient* client) noexcept : mClient(client) {}
+        PendingReply(PendingReply&&) = delete;
+        // 等待中的调用者被销毁（如超时取消）时留下空位，对应的回复到达后被丢弃
+        ~PendingReply() {
+            if (mClient && !mCompleted) {
+                std::replace(mClient->mPending.begin(), mClient->mPending.end(), this, (PendingReply*)nullptr);
+            }
+        }
+    };
+
+    Task<RespValue> commandImpl(std::span<std::string_view const> args) {
+        if (mError) [[unlikely]] {
+            std::rethrow_exception(mError);
+        }
+        co_await mStream.writable();
+        // 无界缓冲模式下写入不会挂起：整条命令连同排队位置一次完成，顺序与回复一致
+        co_await writeCommand(args);
+        PendingReply pending(this);
+        mPending.push_back(&pending);
+        if (!mReading) {
+            mReading = true;
+            mReader = readLoop();
+            spawn_task(mReader);
+        }
+        while (!pending.mCompleted) {
+            co_await pending.mDone.wait();
+        }
+        if (pending.mError) [[unlikely]] {
+            std::rethrow_exception(pending.mError);
+        }
+        if (pending.mValue.is_error()) [[unlikely]] {
+            throw RespError(pending.mValue.mString);
+        }
+        co_return std::move(pending.mValue);
+    }
+
+    Task<> writeCommand(std::span<std::string_view const> args) {
+        char buf[32];
+        auto header = [&](char type, std::size_t number) {
+            buf[0] = type;
+            auto [ptr, ec] = std::to_chars(buf + 1, buf + sizeof buf - 2, number);
+            *ptr++ = '\r';
+            *ptr++ = '\n';
+            return std::string_view(buf, ptr - buf);
+        };
+        co_await mStream.puts(header('*', args.size()));
+        for (auto arg : args) {
+            co_await mStream.puts(header('$', arg.size()));
+            co_await mStream.puts(arg);
+            co_await mStream.puts("\r\n");
+        }
+    }
+
+    // 唤醒调用者可能导致客户端被析构，之后读协程不再访问成员
+    Task<> readLoop() {
+        std::exception_ptr error;
+        try {
+            while (true) {
+                auto value = co_await read_resp(mStream);
+                if (value.mType == RespType::Push) {
+                    continue; // RESP3 的带外推送不对应任何命令
+                }
+                if (mPending.empty()) [[unlikely]] {
+                    throw std::invalid_argument("unexpected RESP reply");
+                }
+                PendingReply* pending = mPending.front();
+                mPending.pop_front();
+                if (!pending) {
+                    continue; // 调用者已放弃
+                }
+                pending->mValue = std::move(value);
+                pending->mCompleted = true;
+                bool alive = true;
+                mReaderAlive = &alive;
+                pending->mDone.notify_one();
+                if (!alive) [[unlikely]] {
+                    co_await DestroySelf();
+                }
+                mReaderAlive = nullptr;
+            }
+        } catch (EOFException const&) {
+            error = std::make_exception_ptr(
+                std::system_error(ECONNRESET, std::system_category(), "redis connection closed"));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        mError = error;
+        while (!mPending.empty()) {
+            PendingReply* pending = mPending.front();
+            mPending.pop_front();
+            if (!pending) {
+                continue;
+            }
+            pending->mError = error;
+            pending->mCompleted = true;
+            bool alive = true;
+            mReaderAlive = &alive;
+            pending->mDone.notify_one();
+            if (!alive) [[unlikely]] {
+                co_await DestroySelf();
+            }
+            mReaderAlive = nullptr;
+        }
+        mReading = false;
+    }
+
+    Stream& mStream;
+    std::deque<PendingReply*> mPending; // 按发出顺序等待回复的调用者，空位表示已放弃
+    std::exception_ptr mError;
+    bool mReading = false;
+    bool* mReaderAlive = nullptr; // 读协程正在唤醒调用者时指向它的存活标志
+    Task<> mReader;
+};
+
+} // namespace co_async
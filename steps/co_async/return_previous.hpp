@@ -22,6 +22,7 @@ struct [[nodiscard]] ReturnPreviousTask {
     std::coroutine_handle<promise_type> mHandle;
 
     ReturnPreviousTask(std::coroutine_handle<promise_type> coroutine) noexcept : mHandle(coroutine) {}
+    ReturnPreviousTask(ReturnPreviousTask&& that) noexcept : mHandle(that.mHandle) { that.mHandle = nullptr; }
     ReturnPreviousTask& operator=(ReturnPreviousTask&&) = delete;
     ~ReturnPreviousTask() {
         if (mHandle)
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "epoll_loop.hpp"
+#include "framing.hpp"
+#include "stream_base.hpp"
+#include "task.hpp"
+#include "timer_loop.hpp"
+#include "wait_queue.hpp"
+#include "when_any.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+namespace co_async {
+
+// 消息类型，位于每条消息的第一个字节
+enum class RpcKind : char {
+    Request = 0,
+    Reply = 1,
+    Error = 2,
+};
+
+// 远端处理失败（处理函数抛出异常或方法不存在）时由 call() 抛出，what() 为远端给出的错误信息
+struct RpcError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct RpcMessage {
+    RpcKind mKind;
+    std::uint64_t mId;
+    std::string_view mMethod; // 仅请求带有方法名
+    std::string_view mBody;
+};
+
+// 多路复用 RPC 的一条连接：每条消息是一个 varint 长度前缀的帧，载荷为
+// 类型（1 字节）+ 调用 ID（varint）[+ 方法名长度（varint）+ 方法名，仅请求] + 正文。
+// 流被设为自动 flush + 无界缓冲：一条消息总是整条写入缓冲区，不会与其他协程的消息交错，
+// 同一轮里多个协程发出的消息合并为一次写出
+template <class Stream>
+struct RpcChannel {
+    static constexpr std::size_t kLowWatermark = 64 * 1024;
+    static constexpr std::size_t kHighWatermark = 1024 * 1024;
+
+    RpcChannel(EpollLoop& loop, Stream& stream) : mStream(stream), mFrames(stream) {
+        stream.set_auto_flush(loop);
+        stream.set_watermarks(kLowWatermark, kHighWatermark);
+    }
+    RpcChannel(RpcChannel&&) = delete;
+
+    // 积压超过高水位时先等待对端读走一部分
+    Task<> send(RpcKind kind, std::uint64_t id, std::string_view method, std::string_view body) {
+        co_await mStream.writable();
+        char header[1 + 2 * kMaxVarintSize<std::uint64_t>];
+        std::size_t len = 0;
+        header[len++] = static_cast<char>(kind);
+        len += encodeVarint(header + len, id);
+        if (kind == RpcKind::Request) {
+            len += encodeVarint<std::uint64_t>(header + len, method.size());
+        }
+        co_await write_varint(mStream, std::uint64_t(len + method.size() + body.size()));
+        co_await mStream.puts(std::string_view(header, len));
+        co_await mStream.puts(method);
+        co_await mStream.puts(body);
+    }
+
+    // 返回的方法名和正文直接指向流缓冲区，在下一次 receive() 之前有效。
+    // 格式错误时抛出 std::invalid_argument，连接关闭时抛出 EOFException
+    Task<RpcMessage> receive() {
+        auto frame = co_await mFrames.read_frame();
+        if (frame.empty()) [[unlikely]] {
+            throw std::invalid_argument("malformed rpc message");
+        }
+        RpcMessage msg;
+        msg.mKind = static_cast<RpcKind>(frame[0]);
+        frame = frame.subspan(1);
+        auto [id, idLen] = decodeVarint<std::uint64_t>(frame);
+        if (idLen == 0) [[unlikely]] {
+            throw std::invalid_argument("malformed rpc message");
+        }
+        msg.mId = id;
+        frame = frame.subspan(idLen);
+        if (msg.mKind == RpcKind::Request) {
+            auto [size, sizeLen] = decodeVarint<std::uint64_t>(frame);
+            if (sizeLen == 0 || size > frame.size() - sizeLen) [[unlikely]] {
+                throw std::invalid_argument("malformed rpc message");
+            }
+            msg.mMethod = std::string_view(frame.data() + sizeLen, size);
+            frame = frame.subspan(sizeLen + size);
+        }
+        msg.mBody = std::string_view(frame.data(), frame.size());
+        co_return msg;
+    }
+
+  private:
+    Stream& mStream;
+    FrameReader<Stream> mFrames;
+};
+
+// 客户端：任意多个协程并发 call()，请求带着各自的调用 ID 共用一条连接，
+// 响应可以乱序到达，由后台的读协程按 ID 交给对应的调用者。
+// 连接出错或关闭时，所有未完成和之后的调用都抛出同一个异常
+template <class Stream>
+struct RpcClient {
+    RpcClient(EpollLoop& loop, TimerLoop& timer, Stream& stream) : mTimer(timer), mChannel(loop, stream) {}
+    RpcClient(RpcClient&&) = delete;
+    ~RpcClient() {
+        if (mReaderAlive) {
+            // 在读协程唤醒调用者的途中被析构：读协程返回后自行释放协程帧
+            *mReaderAlive = false;
+            mReader.mHandle = nullptr;
+        }
+    }
+
+    // timeout 为零表示不设期限；超时抛出 ETIMEDOUT 的 std::system_error，之后到达的响应被丢弃
+    Task<std::string> call(std::string_view method, std::string_view body,
+                           std::chrono::system_clock::duration timeout = {}) {
+        if (mError) [[unlikely]] {
+            std::rethrow_exception(mError);
+        }
+        std::uint64_t id = mNextId++;
+        PendingCall pending(this, id);
+        mPending.emplace(id, &pending);
+        if (!mReading) {
+            mReading = true;
+            mReader = readLoop();
+            spawn_task(mReader);
+        }
+        co_await mChannel.send(RpcKind::Request, id, method, body);
+        if (timeout.count() > 0) {
+            auto res = co_await when_any(waitReply(pending), sleep_for(mTimer, timeout));
+            if (res.index() != 0) {
+                throw std::system_error(ETIMEDOUT, std::system_category(), "rpc call timed out");
+            }
+        } else {
+            co_await waitReply(pending);
+        }
+        if (pending.mKind == RpcKind::Error) [[unlikely]] {
+            throw RpcError(pending.mBody);
+        }
+        co_return std::move(pending.mBody);
+    }
+
+  private:
+    struct PendingCall {
+        RpcClient* mClient;
+        std::uint64_t mId;
+        bool mCompleted = false;
+        RpcKind mKind{};
+        std::string mBody;
+        std::exception_ptr mError;
+        WaitQueue mDone;
+
+        explicit PendingCall(RpcClient* client, std::uint64_t id) noexcept : mClient(client), mId(id) {}
+        PendingCall(PendingCall&&) = delete;
+        // 调用者出错、超时或被外部取消（如 when_any 中落败）时撤下登记，之后到达的响应被丢弃
+        ~PendingCall() {
+            if (!mCompleted) {
+                mClient->mPending.erase(mId);
+            }
+        }
+    };
+
+    static Task<> waitReply(PendingCall& pending) {
+        while (!pending.mCompleted) {
+            co_await pending.mDone.wait();
+        }
+        if (pending.mError) [[unlikely]] {
+            std::rethrow_exception(pending.mError);
+        }
+    }
+
+    // 唤醒调用者可能导致客户端被析构，之后读协程不再访问成员
+    Task<> readLoop() {
+        std::exception_ptr error;
+        try {
+            while (true) {
+                auto msg = co_await mChannel.receive();
+                auto it = mPending.find(msg.mId);
+                if (it == mPending.end() || msg.mKind == RpcKind::Request) {
+                    continue; // 已超时放弃的调用
+                }
+                PendingCall* pending = it->second;
+                mPending.erase(it);
+                pending->mKind = msg.mKind;
+                pending->mBody.assign(msg.mBody);
+                pending->mCompleted = true;
+                bool alive = true;
+                mReaderAlive = &alive;
+                pending->mDone.notify_one();
+                if (!alive) [[unlikely]] {
+                    co_await DestroySelf();
+                }
+                mReaderAlive = nullptr;
+            }
+        } catch (EOFException const&) {
+            error = std::make_exception_ptr(
+                std::system_error(ECONNRESET, std::system_category(), "rpc connection closed"));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        mError = error;
+        while (!mPending.empty()) {
+            PendingCall* pending = mPending.begin()->second;
+            mPending.erase(mPending.begin());
+            pending->mError = error;
+            pending->mCompleted = true;
+            bool alive = true;
+            mReaderAlive = &alive;
+            pending->mDone.notify_one();
+            if (!alive) [[unlikely]] {
+                co_await DestroySelf();
+            }
+            mReaderAlive = nullptr;
+        }
+        mReading = false;
+    }
+
+    TimerLoop& mTimer;
+    RpcChannel<Stream> mChannel;
+    std::uint64_t mNextId = 0;
+    std::unordered_map<std::uint64_t, PendingCall*> mPending;
+    std::exception_ptr mError;
+    bool mReading = false;
+    bool* mReaderAlive = nullptr; // 读协程正在唤醒调用者时指向它的存活标志
+    Task<> mReader;
+};
+
+// 服务端：按方法名注册处理函数。同一连接上的每个请求都在独立的协程中处理，
+// 多个请求并发执行，响应按完成的先后写回
+struct RpcServer {
+    // 处理函数收到请求正文，返回响应正文；抛出的异常作为错误响应返回给调用者
+    using Handler = std::function<Task<std::string>(std::string_view body)>;
+
+    void add_method(std::string name, Handler handler) {
+        mMethods.insert_or_assign(std::move(name), std::move(handler));
+    }
+
+    // 处理一条连接上的全部请求，连接关闭且进行中的请求全部处理完后返回
+    template <class Stream>
+    Task<> serve(EpollLoop& loop, Stream& stream) {
+        RpcChannel<Stream> channel(loop, stream);
+        std::list<Running> running;
+        std::size_t active = 0;
+        WaitQueue idle;
+        while (true) {
+            RpcMessage msg;
+            try {
+                msg = co_await channel.receive();
+            } catch (EOFException const&) {
+                break;
+            }
+            if (msg.mKind != RpcKind::Request) {
+                continue;
+            }
+            // 回收已结束的处理协程
+            running.remove_if([](Running const& r) { return r.mDone; });
+            auto& r = running.emplace_back();
+            ++active;
+            r.mTask = handle(channel, msg.mId, std::string(msg.mMethod), std::string(msg.mBody), r.mDone, active, idle);
+            spawn_task(r.mTask);
+        }
+        while (active) {
+            co_await idle.wait();
+        }
+        // 最后一个处理协程在唤醒本协程后才结束，先让它运行完再销毁
+        co_await loop.tickEnd();
+    }
+
+  private:
+    struct Running {
+        Task<> mTask;
+        bool mDone = false;
+    };
+
+    template <class Stream>
+    Task<> handle(RpcChannel<Stream>& channel, std::uint64_t id, std::string method, std::string body, bool& done,
+                  std::size_t& active, WaitQueue& idle) {
+        RpcKind kind = RpcKind::Reply;
+        std::string reply;
+        auto it = mMethods.find(method);
+        if (it == mMethods.end()) {
+            kind = RpcKind::Error;
+            reply = "unknown rpc method: " + method;
+        } else {
+            try {
+                reply = co_await it->second(body);
+            } catch (std::exception const& e) {
+                kind = RpcKind::Error;
+                reply = e.what();
+            }
+        }
+        try {
+            co_await channel.send(kind, id, {}, reply);
+        } catch (...) {
+            // 连接已断开，读端会随之收到 EOF
+        }
+        done = true;
+        if (--active == 0) {
+            idle.notify_one();
+        }
+    }
+
+    std::unordered_map<std::string, Handler> mMethods;
+};
+
+} // namespace co_async
@@ -6,11 +6,16 @@
 
 #include <arpa/inet.h>
 #include <cstring>
+#include <linux/errqueue.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
+#include <ranges>
+#include <span>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <variant>
+#include <vector>
 
 namespace co_async {
 
@@ -43,6 +48,30 @@ inline IpAddress ip_address(const char* ip) {
     throw std::invalid_argument("invalid domain name or ip address");
 }
 
+// 解析出域名对应的全部地址（IPv4 与 IPv6），顺序与 getaddrinfo 的偏好顺序一致
+inline std::vector<IpAddress> ip_addresses(const char* host) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM; // 每个地址只返回一次
+    addrinfo* result = nullptr;
+    if (int err = getaddrinfo(host, nullptr, &hints, &result); err != 0) [[unlikely]] {
+        throw std::invalid_argument(std::string("getaddrinfo: ") + gai_strerror(err));
+    }
+    std::vector<IpAddress> addrs;
+    for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET) {
+            addrs.emplace_back(((sockaddr_in*)ai->ai_addr)->sin_addr);
+        } else if (ai->ai_family == AF_INET6) {
+            addrs.emplace_back(((sockaddr_in6*)ai->ai_addr)->sin6_addr);
+        }
+    }
+    freeaddrinfo(result);
+    if (addrs.empty()) [[unlikely]] {
+        throw std::invalid_argument("invalid domain name or ip address");
+    }
+    return addrs;
+}
+
 struct SocketAddress {
     sockaddr_storage mAddr;
     socklen_t mAddrLen;
@@ -92,15 +121,47 @@ inline void socketSetOption(AsyncFile& sock, int level, int opt, const T& optVal
     checkError(setsockopt(sock.fileNo(), level, opt, &optVal, sizeof(optVal)));
 }
 
+inline Task<void> socketWaitConnected(EpollLoop& loop, AsyncFile& sock) {
+    co_await wait_file_event(loop, sock, EPOLLOUT);
+    int err = socketGetOption<int>(sock, SOL_SOCKET, SO_ERROR);
+    if (err != 0) [[unlikely]] {
+        throw std::system_error(err, std::system_category(), "connect");
+    }
+}
+
 inline Task<void> socketConnect(EpollLoop& loop, AsyncFile& sock, const SocketAddress& addr) {
     sock.setNonblock();
     int res = checkErrorNonBlock(connect(sock.fileNo(), (const sockaddr*)&addr.mAddr, addr.mAddrLen), -1, EINPROGRESS);
     if (res == -1) [[likely]] {
-        co_await wait_file_event(loop, sock, EPOLLOUT);
-        int err = socketGetOption<int>(sock, SOL_SOCKET, SO_ERROR);
-        if (err != 0) [[unlikely]] {
-            throw std::system_error(err, std::system_category(), "connect");
+        co_await socketWaitConnected(loop, sock);
+    }
+}
+
+// TCP Fast Open：首段请求数据随 SYN 一起发出，省去一个 RTT。
+// 没有 cookie 时内核只发送 SYN（EINPROGRESS），系统禁用 TFO 时（EOPNOTSUPP）退化为普通 connect，
+// 两种情况下未被 SYN 捎带的数据都在连接建立后照常写出
+inline Task<void>
+socketConnectWithData(EpollLoop& loop, AsyncFile& sock, const SocketAddress& addr, std::span<char const> data) {
+    sock.setNonblock();
+    ssize_t res = sendto(sock.fileNo(),
+                         data.data(),
+                         data.size(),
+                         MSG_FASTOPEN | MSG_NOSIGNAL,
+                         (const sockaddr*)&addr.mAddr,
+                         addr.mAddrLen);
+    if (res == -1) {
+        if (errno == EINPROGRESS) {
+            co_await socketWaitConnected(loop, sock);
+        } else if (errno == EOPNOTSUPP) {
+            co_await socketConnect(loop, sock, addr);
+        } else [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "sendto");
         }
+        res = 0;
+    }
+    data = data.subspan(res);
+    while (!data.empty()) {
+        data = data.subspan(co_await write_file(loop, sock, data));
     }
 }
 
@@ -123,18 +184,119 @@ inline AsyncFile create_udp_socket(const SocketAddress& addr) {
     return sock;
 }
 
+// UDP 的 bind 是立即完成的，无需等待
+inline AsyncFile create_udp_server(const SocketAddress& addr) {
+    AsyncFile sock = create_udp_socket(addr);
+    checkError(bind(sock.fileNo(), (const sockaddr*)&addr.mAddr, addr.mAddrLen));
+    return sock;
+}
+
 inline Task<AsyncFile> create_tcp_client(EpollLoop& loop, const SocketAddress& addr) {
     AsyncFile sock(socket(addr.mAddr.ss_family, SOCK_STREAM, 0));
     co_await socketConnect(loop, sock, addr);
     co_return sock;
 }
 
-inline Task<AsyncFile> create_tcp_server(EpollLoop& loop, const SocketAddress& addr) {
+inline Task<AsyncFile> connect_with_data(EpollLoop& loop, const SocketAddress& addr, std::span<char const> data) {
     AsyncFile sock(socket(addr.mAddr.ss_family, SOCK_STREAM, 0));
+    co_await socketConnectWithData(loop, sock, addr, data);
+    co_return sock;
+}
+
+// fastOpenQueue 为等待三次握手完成的 TFO 连接队列长度，默认 0 不启用 TCP Fast Open：
+// 捎带在 SYN 中的数据可能被重放，只有能容忍重复请求的服务才应开启（还需 net.ipv4.tcp_fastopen 含服务端位 2）。
+// reusePort 开启 SO_REUSEPORT：每个线程各自的 loop 绑定同一端口，由内核把新连接分散到各个监听套接字
+inline Task<AsyncFile> create_tcp_server(EpollLoop& loop, const SocketAddress& addr, int fastOpenQueue = 0,
+                                         bool reusePort = false) {
+    AsyncFile sock(socket(addr.mAddr.ss_family, SOCK_STREAM, 0));
+    if (reusePort) {
+        socketSetOption<int>(sock, SOL_SOCKET, SO_REUSEPORT, 1);
+    }
     co_await socketBind(loop, sock, addr);
+    if (fastOpenQueue > 0 && addr.mAddr.ss_family != AF_UNIX) {
+        socketSetOption(sock, IPPROTO_TCP, TCP_FASTOPEN, fastOpenQueue);
+    }
     co_return sock;
 }
 
+// MSG_MORE：提示内核后面还有数据，暂不发出不满的报文段，直到一次不带该标志的写入
+inline Task<std::size_t> write_file_more(EpollLoop& loop, AsyncFile& sock, std::span<char const> buffer) {
+    co_await wait_file_event(loop, sock, EPOLLOUT | EPOLLHUP);
+    ssize_t res = send(sock.fileNo(), buffer.data(), buffer.size(), MSG_MORE | MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (res == -1 && errno == ENOTSOCK) {
+        co_return writeFileSync(sock, buffer);
+    }
+    co_return checkErrorNonBlock(res);
+}
+
+// MSG_ZEROCOPY：内核直接引用用户内存发送，完成通知经错误队列送达，收到通知前缓冲区不可改动或释放。
+// 同一套接字上的零拷贝写需串行进行（通知只按次数统计，不区分属于哪次写入）
+
+// 每个套接字开启一次 SO_ZEROCOPY，之后才能使用零拷贝写；未开启时内核忽略 MSG_ZEROCOPY，也不会发出完成通知
+inline void socket_enable_zerocopy(AsyncFile& sock) { socketSetOption<int>(sock, SOL_SOCKET, SO_ZEROCOPY, 1); }
+
+// 取走错误队列中已到达的全部零拷贝完成通知，返回其覆盖的 send 次数
+inline std::size_t socketReapZeroCopy(AsyncFile& sock) {
+    std::size_t completed = 0;
+    while (true) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err)) + 64];
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (checkErrorNonBlock(recvmsg(sock.fileNo(), &msg, MSG_ERRQUEUE), -1, EAGAIN) == -1) {
+            return completed;
+        }
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            auto* ee = (sock_extended_err*)CMSG_DATA(cm);
+            if (ee->ee_errno == 0 && ee->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                completed += ee->ee_data - ee->ee_info + 1; // 通知覆盖 [ee_info, ee_data] 区间内的 send
+            }
+        }
+    }
+}
+
+// 写出全部数据，并等到内核释放对 buffer 的引用后才返回。套接字须已经 socket_enable_zerocopy
+inline Task<std::size_t> write_file_zerocopy(EpollLoop& loop, AsyncFile& sock, std::span<char const> buffer) {
+    std::size_t pending = 0, written = 0;
+    while (written != buffer.size()) {
+        auto chunk = buffer.subspan(written);
+        ssize_t res = send(sock.fileNo(), chunk.data(), chunk.size(), MSG_ZEROCOPY | MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (res != -1) {
+            written += res;
+            ++pending;
+        } else if (errno == EAGAIN) {
+            co_await wait_file_event(loop, sock, EPOLLOUT);
+        } else if (errno == ENOBUFS) {
+            // 锁定页数超过 optmem 限额：先回收已有通知，仍无可回收时退化为普通拷贝发送
+            if (std::size_t n = socketReapZeroCopy(sock)) {
+                pending -= n;
+            } else if (pending != 0) {
+                co_await wait_file_event(loop, sock, EPOLLERR);
+            } else {
+                written += co_await write_file(loop, sock, chunk);
+            }
+        } else [[unlikely]] {
+            throw std::system_error(errno, std::system_category(), "send");
+        }
+    }
+    while (pending != 0) {
+        pending -= socketReapZeroCopy(sock);
+        if (pending != 0) {
+            co_await wait_file_event(loop, sock, EPOLLERR); // 错误队列非空时 epoll 报告 EPOLLERR
+        }
+    }
+    co_return written;
+}
+
+// buffer 的所有权转移进协程帧，保证在内核释放前一直存活
+template <class Buffer>
+    requires std::ranges::contiguous_range<Buffer> && std::ranges::sized_range<Buffer>
+inline Task<std::size_t> write_zerocopy(EpollLoop& loop, AsyncFile& sock, Buffer buffer) {
+    auto bytes = std::span<char const>((char const*)std::ranges::data(buffer),
+                                       std::ranges::size(buffer) * sizeof(std::ranges::range_value_t<Buffer>));
+    co_return co_await write_file_zerocopy(loop, sock, bytes);
+}
+
 // 本身就是非阻塞的快速操作，无需被设计成协程函数
 inline void socket_listen(AsyncFile& sock, int backlog = SOMAXCONN) { checkError(listen(sock.fileNo(), backlog)); }
 inline void socket_shotdown(AsyncFile& sock, int flags = SHUT_RDWR) { checkError(shutdown(sock.fileNo(), flags)); }
@@ -153,7 +315,7 @@ inline Task<std::tuple<AsyncFile, AddrType>> socket_accept(EpollLoop& loop, Asyn
     } else [[unlikely]] {
         throw std::runtime_error("unknown address family");
     }
-    co_return {AsyncFile(res), addr};
+    co_return std::tuple<AsyncFile, AddrType>(AsyncFile(res), addr);
 }
 
 } // namespace co_async
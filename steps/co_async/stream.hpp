@@ -1,20 +1,62 @@
 #pragma once
 
+#include "buffer_chain.hpp"
+#include "direct_file.hpp"
 #include "epoll_loop.hpp"
+#include "memory_stream.hpp"
+#include "pipe.hpp"
+#include "regular_file.hpp"
+#include "socket.hpp"
 #include "stdio.hpp"
 #include "stream_base.hpp"
 
+#include <algorithm>
+
 namespace co_async {
 
+// 先等待可读，等到后 mReadable 置位，随后的一次读取不必再经过 epoll
+inline Task<> waitReadable(EpollLoop& loop, AsyncFile& file, bool& readable) {
+    co_await wait_file_event(loop, file, EPOLLIN | EPOLLRDHUP);
+    readable = true;
+}
+
+inline Task<std::size_t> readReadable(EpollLoop& loop, AsyncFile& file, bool& readable, std::span<char> buffer) {
+    if (std::exchange(readable, false)) {
+        auto len = checkErrorNonBlock(::read(file.fileNo(), buffer.data(), buffer.size()), -1);
+        if (len != -1) [[likely]] {
+            co_return len;
+        }
+    }
+    co_return co_await read_file(loop, file, buffer);
+}
+
 struct FileBuf {
     EpollLoop* mLoop;
     AsyncFile mFile;
+    std::size_t mZeroCopyThreshold = 0; // 0 表示不使用 MSG_ZEROCOPY
+    bool mReadable = false;
 
     FileBuf() noexcept : mLoop(nullptr) {}
     FileBuf(EpollLoop& loop, AsyncFile&& file) : mLoop(&loop), mFile(std::move(file)) {}
 
-    Task<std::size_t> read(std::span<char> buffer) { return read_file(*mLoop, mFile, buffer); }
-    Task<std::size_t> write(std::span<const char> buffer) { return write_file(*mLoop, mFile, buffer); }
+    // 仅适用于套接字：不小于 threshold 的写入改用 MSG_ZEROCOPY，并在内核释放缓冲区后才完成。
+    // 首次开启时为套接字设置 SO_ZEROCOPY；要真正生效，threshold 不能超过输出缓冲区的大小
+    void set_zerocopy_threshold(std::size_t threshold) {
+        if (threshold && !mZeroCopyThreshold) {
+            socket_enable_zerocopy(mFile);
+        }
+        mZeroCopyThreshold = threshold;
+    }
+
+    Task<> waitRead() { return waitReadable(*mLoop, mFile, mReadable); }
+    Task<std::size_t> read(std::span<char> buffer) { return readReadable(*mLoop, mFile, mReadable, buffer); }
+    Task<std::size_t> write(std::span<const char> buffer) {
+        if (mZeroCopyThreshold && buffer.size() >= mZeroCopyThreshold) {
+            return write_file_zerocopy(*mLoop, mFile, buffer);
+        }
+        return write_file(*mLoop, mFile, buffer);
+    }
+    Task<std::size_t> write_more(std::span<const char> buffer) { return write_file_more(*mLoop, mFile, buffer); }
 };
 
 using FileIStream = IStream<FileBuf>;
@@ -25,6 +67,7 @@ struct StdioBuf {
     EpollLoop* mLoop;
     AsyncFile mFileIn;
     AsyncFile mFileOut;
+    bool mReadable = false;
 
     StdioBuf() noexcept : mLoop(nullptr) {}
     StdioBuf(EpollLoop& loop) : mLoop(&loop), mFileIn(async_stdin(true)), mFileOut(async_stdout()) {}
@@ -33,7 +76,8 @@ struct StdioBuf {
           mFileIn(std::move(fileIn)),
           mFileOut(std::move(fileOut)) {}
 
-    Task<std::size_t> read(std::span<char> buffer) { return read_file(*mLoop, mFileIn, buffer); }
+    Task<> waitRead() { return waitReadable(*mLoop, mFileIn, mReadable); }
+    Task<std::size_t> read(std::span<char> buffer) { return readReadable(*mLoop, mFileIn, mReadable, buffer); }
     Task<std::size_t> write(std::span<const char> buffer) { return write_file(*mLoop, mFileOut, buffer); }
 };
 
@@ -66,7 +110,19 @@ struct StringWriteBuf {
     }
 };
 
+// 不需要复制时可以改用 MemoryIStream，它直接以字符串为缓冲区
 using StringIStream = IStream<StringReadBuf>;
 using StringOStream = OStream<StringWriteBuf>;
 
+using ChainIStream = IStream<ChainBuf>;
+using ChainOStream = OStream<ChainBuf>;
+
+using PipeStream = IOStream<PipeBuf>;
+
+using RegularFileIStream = IStream<RegularFileBuf>;
+using RegularFileOStream = OStream<RegularFileBuf>;
+
+using DirectFileIStream = IStream<DirectFileBuf, AlignedBuffer>;
+using DirectFileOStream = OStream<DirectFileBuf, AlignedBuffer>;
+
 } // namespace co_async
@@ -1,18 +1,56 @@
 #pragma once
 
+#include "buffer_chain.hpp"
+#include "buffer_pool.hpp"
+#include "epoll_loop.hpp"
 #include "task.hpp"
+#include "wait_queue.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstring>
+#include <exception>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#if __has_include(<format>)
+#include <format>
+#endif
 
 namespace co_async {
 
 struct EOFException {};
 
-template <class Reader>
+// 缓冲区来自 StreamBuf 提供的 bufferPool()，未提供时使用线程局部池 BufferPool::local()。
+// 同一线程上的各个事件循环与流共用线程局部池，流须在本线程退出前析构
+template <class StreamBuf>
+BufferPool& streamBufferPool(StreamBuf* buf) {
+    if constexpr (requires { buf->bufferPool(); }) {
+        return buf->bufferPool();
+    } else {
+        return BufferPool::local();
+    }
+}
+
+// 缓冲区只在真正读到数据时才从池中申请，读空后立即归还，空闲连接不占用缓冲内存。
+// Storage 决定缓冲区的存储方式，默认为 PooledBuffer；MirroredBuffer 使未读数据始终连续、补充数据时无需搬移
+template <class Reader, class Storage = PooledBuffer>
 struct IStreamBase {
-    explicit IStreamBase(std::size_t bufferSize = 8192)
-        : mBuffer(std::make_unique<char[]>(bufferSize)),
-          mBufSize(bufferSize) {}
+    // 视图存储（kView）直接指向已在内存中的数据源，整个数据源一开始就是未读区，读完即 EOF
+    static constexpr bool kView = requires { requires Storage::kView; };
+    // 可变容量的存储（如 PooledBuffer）支持自适应缓冲区大小
+    static constexpr bool kResizable = requires(Storage& storage) { storage.resize(std::size_t(), std::size_t()); };
+
+    explicit IStreamBase(std::size_t bufferSize = Storage::kDefaultSize) : mBuffer(bufferSize) {}
+    explicit IStreamBase(Storage storage)
+        requires kView
+        : mBuffer(std::move(storage)),
+          mEnd(mBuffer.size()) {}
     IStreamBase(IStreamBase&&) = default;
     IStreamBase& operator=(IStreamBase&&) = default;
 
@@ -20,156 +58,725 @@ struct IStreamBase {
         if (bufferEmpty()) {
             co_await fillBuffer();
         }
-        co_return mBuffer[mIndex++];
+        char c = mBuffer[mIndex++];
+        if (bufferEmpty()) {
+            mBuffer.release();
+        }
+        co_return c;
     }
 
+    // 直接在缓冲区的未读区中查找行尾并整段追加，不逐字节 co_await getchar()：
+    // 同步完成的 Task 在未开启尾调用优化时（-O0）每层都占一帧栈，逐字节读一整个缓冲区会把栈耗尽
     Task<std::string> getline(char eol = '\n') {
         std::string s;
         while (true) {
-            char c = co_await getchar();
-            if (c == eol) {
+            if (bufferEmpty()) {
+                co_await fillBuffer();
+            }
+            auto buf = peek();
+            auto p = static_cast<char const*>(std::memchr(buf.data(), eol, buf.size()));
+            if (p) {
+                std::size_t len = p - buf.data();
+                s.append(buf.data(), len);
+                consume(len + 1);
                 break;
             }
-            s.push_back(c);
+            s.append(buf.data(), buf.size());
+            consume(buf.size());
         }
         co_return s;
     }
 
+    // 行尾可能被拆在两次读取之间：每次把整段未读数据追加到结果后，从上次末尾往前 eol.size() - 1 字节处继续查找，
+    // 找到后只消费到行尾为止，多追加的部分截掉，仍留在缓冲区中
     Task<std::string> getline(std::string_view eol) {
         std::string s;
         while (true) {
-            char c = co_await getchar();
-            if (c == eol[0]) {
-                std::size_t i;
-                for (i = 1; i < eol.size(); ++i) {
-                    char c = co_await getchar();
-                    if (c != eol[i]) {
-                        break;
-                    }
-                }
-                if (i == eol.size()) {
-                    break;
-                }
-                for (std::size_t j = 0; j < i; ++j) {
-                    s.push_back(eol[j]);
-                }
-                continue;
+            if (bufferEmpty()) {
+                co_await fillBuffer();
             }
-            s.push_back(c);
+            auto buf = peek();
+            std::size_t old = s.size();
+            std::size_t from = old < eol.size() ? 0 : old - eol.size() + 1;
+            s.append(buf.data(), buf.size());
+            if (auto pos = s.find(eol, from); pos != s.npos) {
+                consume(pos + eol.size() - old);
+                s.resize(pos);
+                break;
+            }
+            consume(buf.size());
         }
         co_return s;
     }
 
+    // 整段复制缓冲区中已有的数据；剩余部分不小于缓冲区容量时直接读入目标字符串，不经过缓冲区
     Task<std::string> getn(std::size_t n) {
         std::string s;
-        for (std::size_t i = 0; i < n; ++i) {
-            char c = co_await getchar();
-            s.push_back(c);
+        s.reserve(n);
+        while (s.size() < n) {
+            if (bufferEmpty()) {
+                if constexpr (!kView) {
+                    if (n - s.size() >= mBuffer.size()) {
+                        co_await readDirect(s, n);
+                        break;
+                    }
+                }
+                co_await fillBuffer();
+            }
+            auto buf = peek();
+            std::size_t len = std::min(buf.size(), n - s.size());
+            s.append(buf.data(), len);
+            consume(len);
         }
         co_return s;
     }
 
+    // 自适应模式：一次读取填满缓冲区时，下次申请的容量翻倍（至多 maxSize），读到的数据不足四分之一时减半
+    // （不低于开启时的容量）；ensure(n) 遇到超过当前容量的大帧时直接扩容到能容纳它。
+    // 缓冲区读空即归还，空闲连接本就不占用缓冲区，新容量在下次申请时生效
+    void set_adaptive(std::size_t maxSize)
+        requires kResizable
+    {
+        mMinSize = mBuffer.size();
+        mMaxSize = std::max(mMinSize, std::bit_floor(maxSize));
+        mNextSize = mMinSize;
+    }
+
+    // 以下接口直接暴露缓冲区中的未读数据，供解析器零拷贝地使用：
+    // peek() 返回当前未读区，ensure(n) 保证其中至少有 n 字节，consume(n) 丢弃开头的 n 字节
+    std::span<char const> peek() const noexcept { return {mBuffer.data() + mIndex, mEnd - mIndex}; }
+
+    // ensure(n) 能满足的最大 n：缓冲区容量，自适应模式下为可扩容到的上限；视图不受限制
+    std::size_t ensure_limit() const noexcept {
+        if constexpr (kView) {
+            return std::size_t(-1);
+        } else {
+            return std::max(mBuffer.size(), mMaxSize);
+        }
+    }
+
+    Task<std::span<char const>> ensure(std::size_t n) {
+        if (!kView && n > mBuffer.size()) [[unlikely]] {
+            if constexpr (kResizable) {
+                if (n <= mMaxSize) {
+                    growBuffer(n);
+                }
+            }
+            if (n > mBuffer.size()) {
+                throw std::length_error("ensure() exceeds stream buffer capacity");
+            }
+        }
+        while (mEnd - mIndex < n) {
+            co_await fillMore();
+        }
+        co_return peek();
+    }
+
+    void consume(std::size_t n) noexcept {
+        mIndex += n;
+        if (bufferEmpty()) {
+            mBuffer.release();
+        }
+    }
+
+    // 跳过空白后直接在缓冲区上用 from_chars 解析一个数，不经过临时字符串。
+    // 没有可解析的数字时跳过这个词（到下一个空白为止）并抛出 std::invalid_argument，消息中带有该词的开头；
+    // 超出 T 的范围时跳过该数并抛出 std::out_of_range。两种情况下重试都会从后面的输入继续
+    template <std::integral T>
+    Task<T> read_int(int base = 10) {
+        return readNumber<T>(base);
+    }
+
+    Task<double> read_double() { return readNumber<double>(std::chars_format::general); }
+
   private:
     bool bufferEmpty() const noexcept { return mIndex == mEnd; }
 
+    static bool isSpace(char c) noexcept { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+    // 可能属于 base 进制整数的字符：该进制的数字和负号（from_chars 不接受正号和 0x 前缀）
+    static bool isNumberChar(char c, int base) noexcept {
+        unsigned digit = 36;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'z') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'Z') {
+            digit = c - 'A' + 10;
+        }
+        return digit < static_cast<unsigned>(base) || c == '-';
+    }
+
+    // 可能属于十进制浮点数的字符：数字、小数点、符号、指数 e，以及 inf/infinity/nan 中的字母
+    static bool isNumberChar(char c, std::chars_format) noexcept {
+        if ((c >= '0' && c <= '9') || c == '.' || c == '+' || c == '-') {
+            return true;
+        }
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        return c == 'e' || c == 'i' || c == 'n' || c == 'f' || c == 't' || c == 'y' || c == 'a';
+    }
+
+    template <class T, class Fmt>
+    Task<T> readNumber(Fmt fmt) {
+        while (true) {
+            if (bufferEmpty()) {
+                co_await fillBuffer();
+            }
+            while (mIndex != mEnd && isSpace(mBuffer[mIndex])) {
+                ++mIndex;
+            }
+            if (!bufferEmpty()) {
+                break;
+            }
+            mBuffer.release();
+        }
+        // 数字可能跨越两次读取，扫描到非数字字符或 EOF 才开始解析
+        std::size_t scanned = 0;
+        while (true) {
+            auto buf = peek();
+            while (scanned != buf.size() && isNumberChar(buf[scanned], fmt)) {
+                ++scanned;
+            }
+            if (scanned != buf.size()) {
+                break;
+            }
+            if (!kView && buf.size() == mBuffer.size()) [[unlikely]] {
+                throw std::length_error("number exceeds stream buffer capacity");
+            }
+            bool eof = false;
+            try {
+                co_await fillMore();
+            } catch (EOFException const&) {
+                eof = true;
+            }
+            if (eof) {
+                break;
+            }
+        }
+        auto buf = peek();
+        T value;
+        auto [ptr, ec] = std::from_chars(buf.data(), buf.data() + scanned, value, fmt);
+        if (ec == std::errc::invalid_argument) [[unlikely]] {
+            co_await skipInvalid();
+        }
+        consume(ptr - buf.data());
+        if (ec == std::errc::result_out_of_range) [[unlikely]] {
+            throw std::out_of_range("number out of range");
+        }
+        co_return value;
+    }
+
+    // 跳过不是数字的词，抛出 std::invalid_argument
+    Task<> skipInvalid() {
+        constexpr std::size_t kMaxQuoted = 32;
+        std::string token;
+        while (true) {
+            auto buf = peek();
+            std::size_t n = 0;
+            while (n != buf.size() && !isSpace(buf[n])) {
+                ++n;
+            }
+            token.append(buf.data(), std::min(n, kMaxQuoted - token.size()));
+            consume(n);
+            if (n != buf.size()) {
+                break;
+            }
+            bool eof = false;
+            try {
+                co_await fillBuffer();
+            } catch (EOFException const&) {
+                eof = true;
+            }
+            if (eof) {
+                break;
+            }
+        }
+        throw std::invalid_argument("stream does not contain a number: \"" + token + "\"");
+    }
+
+    // 在保留未读数据的前提下再读入一些数据。
+    // 环形存储只填充 [mEnd, mIndex + size) 这段空闲区；线性存储在尾部没有空间时把未读数据搬到开头
+    Task<> fillMore() {
+        if (bufferEmpty()) {
+            co_await fillBuffer();
+            co_return;
+        }
+        if constexpr (kView) {
+            throw EOFException();
+        } else {
+            if constexpr (Storage::kMirrored) {
+                if (mIndex >= mBuffer.size()) {
+                    mIndex -= mBuffer.size();
+                    mEnd -= mBuffer.size();
+                }
+            } else {
+                // 自适应模式下未读数据已占去大半个缓冲区时扩容，而不是反复搬移
+                if constexpr (kResizable) {
+                    if (mMaxSize && mEnd == mBuffer.size() && mBuffer.size() < mMaxSize &&
+                        mEnd - mIndex > mBuffer.size() / 2) {
+                        growBuffer(mBuffer.size() * 2);
+                    }
+                }
+                if (mEnd == mBuffer.size()) {
+                    std::memmove(mBuffer.data(), mBuffer.data() + mIndex, mEnd - mIndex);
+                    mEnd -= mIndex;
+                    mIndex = 0;
+                }
+            }
+            std::size_t limit = Storage::kMirrored ? mIndex + mBuffer.size() : mBuffer.size();
+            auto* that = static_cast<Reader*>(this); // CRTP
+            std::size_t len = co_await that->read(std::span(mBuffer.data() + mEnd, limit - mEnd));
+            if (len == 0) [[unlikely]] {
+                throw EOFException();
+            }
+            mEnd += len;
+        }
+    }
+
     Task<> fillBuffer() {
-        static_assert(
-            requires(Reader * reader, std::span<char> buffer) {
-                { reader->read(buffer) } -> std::same_as<Task<std::size_t>>;
-            }, "Reader type must implement: Task<std::size_t> read(std::span<char>)");
-        auto* that = static_cast<Reader*>(this); // CRTP
-        mEnd = co_await that->read(std::span(mBuffer.get(), mBufSize));
-        mIndex = 0;
-        if (mEnd == 0) [[unlikely]] {
+        if constexpr (kView) {
             throw EOFException();
+        } else {
+            static_assert(
+                requires(Reader * reader, std::span<char> buffer) {
+                    { reader->read(buffer) } -> std::same_as<Task<std::size_t>>;
+                }, "Reader type must implement: Task<std::size_t> read(std::span<char>)");
+            auto* that = static_cast<Reader*>(this); // CRTP
+            // Reader 可以提供 waitRead() 先等待数据到达，再申请缓冲区
+            if constexpr (requires { that->waitRead(); }) {
+                co_await that->waitRead();
+            }
+            if constexpr (kResizable) {
+                if (mMaxSize && mNextSize != mBuffer.size()) {
+                    mBuffer.resize(mNextSize);
+                }
+            }
+            mBuffer.acquire(streamBufferPool(that));
+            mEnd = co_await that->read(std::span(mBuffer.data(), mBuffer.size()));
+            mIndex = 0;
+            if (mEnd == 0) [[unlikely]] {
+                mBuffer.release();
+                throw EOFException();
+            }
+            if constexpr (kResizable) {
+                if (mMaxSize) {
+                    std::size_t size = mBuffer.size();
+                    if (mEnd == size) {
+                        mNextSize = std::min(size * 2, mMaxSize);
+                    } else if (mEnd < size / 4) {
+                        mNextSize = std::max(size / 2, mMinSize);
+                    }
+                }
+            }
         }
     }
 
-    std::unique_ptr<char[]> mBuffer;
+    // 把未读数据搬到开头后换用容量至少为 size 的缓冲区
+    void growBuffer(std::size_t size) {
+        if (bufferEmpty()) {
+            mIndex = mEnd = 0;
+        } else if (mIndex) {
+            std::memmove(mBuffer.data(), mBuffer.data() + mIndex, mEnd - mIndex);
+            mEnd -= mIndex;
+            mIndex = 0;
+        }
+        mBuffer.resize(size, mEnd);
+        mNextSize = mBuffer.size();
+    }
+
+    // 新增的部分随后被 read 整段覆盖，有 resize_and_overwrite（C++23）时省掉 resize 的清零
+    static void resizeForOverwrite(std::string& s, std::size_t n) {
+#if __cpp_lib_string_resize_and_overwrite
+        s.resize_and_overwrite(n, [](char*, std::size_t size) noexcept { return size; });
+#else
+        s.resize(n);
+#endif
+    }
+
+    Task<> readDirect(std::string& s, std::size_t n) {
+        auto* that = static_cast<Reader*>(this); // CRTP
+        std::size_t got = s.size();
+        resizeForOverwrite(s, n);
+        while (got < n) {
+            std::size_t len = co_await that->read(std::span(s.data() + got, n - got));
+            if (len == 0) [[unlikely]] {
+                s.resize(got);
+                throw EOFException();
+            }
+            got += len;
+        }
+    }
+
+    Storage mBuffer;
     std::size_t mIndex = 0;
     std::size_t mEnd = 0;
-    std::size_t mBufSize = 0;
+    std::size_t mMinSize = 0;
+    std::size_t mMaxSize = 0; // 为 0 时不启用自适应
+    std::size_t mNextSize = 0;
 };
 
-template <class Writer>
+// 缓冲区在首次写入时从池中申请，flush 写空后归还
+template <class Writer, class Storage = PooledBuffer>
 struct OStreamBase {
-    explicit OStreamBase(std::size_t bufferSize = 8192)
-        : mBuffer(std::make_unique<char[]>(bufferSize)),
-          mBufSize(bufferSize) {}
-    OStreamBase(OStreamBase&&) = default;
-    OStreamBase& operator=(OStreamBase&&) = default;
+    explicit OStreamBase(std::size_t bufferSize = Storage::kDefaultSize) : mBuffer(bufferSize) {}
+    // 不支持在 flush 进行中移动流
+    OStreamBase(OStreamBase&& that) noexcept
+        : mBuffer(std::move(that.mBuffer)),
+          mIndex(std::exchange(that.mIndex, 0)),
+          mPending(std::move(that.mPending)),
+          mUnbounded(that.mUnbounded),
+          mLowWatermark(that.mLowWatermark),
+          mHighWatermark(that.mHighWatermark),
+          mFlushError(std::move(that.mFlushError)),
+          mAutoFlushLoop(that.mAutoFlushLoop) {}
+    OStreamBase& operator=(OStreamBase&& that) noexcept {
+        std::swap(mBuffer, that.mBuffer);
+        std::swap(mIndex, that.mIndex);
+        std::swap(mPending, that.mPending);
+        std::swap(mUnbounded, that.mUnbounded);
+        std::swap(mLowWatermark, that.mLowWatermark);
+        std::swap(mHighWatermark, that.mHighWatermark);
+        std::swap(mFlushError, that.mFlushError);
+        std::swap(mAutoFlushLoop, that.mAutoFlushLoop);
+        return *this;
+    }
+
+    // 自动 flush 模式：写入只把流标记为脏，由 loop 在本轮事件分发完后统一 flush 一次，
+    // 同一轮里多个协程写入的数据合并为一次系统调用。缓冲区写满（高水位）时仍立即 flush，
+    // 此时若 Writer 提供 write_more()（如套接字的 MSG_MORE），则提示内核暂缓发出不满的报文段。
+    // 后台 flush 的异常无人接收，因此写出失败时（任何模式下）记下异常并丢弃未写出的数据，
+    // 此后不再安排 flush，之后的每次写入和 flush 都抛出该异常
+    void set_auto_flush(EpollLoop& loop) noexcept { mAutoFlushLoop = &loop; }
+
+    // 无界缓冲模式：写入永不因缓冲区满而挂起，数据追加到缓冲链中由 flush 在后台写出。
+    // 积压超过 high 时立即开始后台写出；生产者在写入前 co_await writable()，
+    // 积压超过 high 时挂起，写出到不超过 low 时恢复，从而不会在一条消息写到一半时被慢速对端卡住。
+    void set_watermarks(std::size_t low, std::size_t high) {
+        if (low > high) [[unlikely]] {
+            throw std::invalid_argument("low watermark exceeds high watermark");
+        }
+        if (!mUnbounded && mIndex) {
+            mPending.append(std::span<char const>(mBuffer.data(), mIndex));
+            mIndex = 0;
+            mBuffer.release();
+        }
+        mUnbounded = true;
+        mLowWatermark = low;
+        mHighWatermark = high;
+    }
+
+    // 已写入但尚未交给内核的字节数
+    std::size_t buffered() const noexcept { return mUnbounded ? mPending.size() : mIndex; }
+
+    Task<> writable() {
+        checkFlushError();
+        if (!mUnbounded || mPending.size() <= mHighWatermark) {
+            co_return;
+        }
+        if (!mFlushScheduled && !mFlushing) {
+            scheduleFlush(false);
+        }
+        while (mPending.size() > mLowWatermark) {
+            co_await mWritable.wait();
+            checkFlushError();
+        }
+    }
 
     Task<> putchar(char c) {
-        if (bufferFull()) {
-            co_await flush();
+        checkFlushError();
+        if (mUnbounded) {
+            mPending.prepare()[0] = c;
+            mPending.commit(1);
+            markDirty();
+            co_return;
+        }
+        // 等待期间其他协程可能又填满了缓冲区，与 puts 一样重新检查
+        while (bufferFull()) {
+            co_await flushBuffer(mAutoFlushLoop != nullptr);
+        }
+        if (!mBuffer.allocated()) [[unlikely]] {
+            mBuffer.acquire(streamBufferPool(static_cast<Writer*>(this)));
         }
         mBuffer[mIndex++] = c;
+        markDirty();
     }
 
     Task<> puts(std::string_view s) {
-        for (char c : s) {
-            co_await putchar(c);
+        checkFlushError();
+        if (mUnbounded) {
+            mPending.append(std::span<char const>(s.data(), s.size()));
+            markDirty();
+            co_return;
+        }
+        while (!s.empty()) {
+            if (bufferFull()) {
+                co_await flushBuffer(mAutoFlushLoop != nullptr);
+            }
+            auto room = freeRegion();
+            std::size_t n = std::min(room.size(), s.size());
+            std::memcpy(room.data(), s.data(), n);
+            mIndex += n;
+            s.remove_prefix(n);
+        }
+        markDirty();
+    }
+
+    // 依次写出各参数：字符串原样写出，数值用 to_chars 转换，不构造临时 std::string
+    template <class... Args>
+    Task<> print(Args const&... args) {
+        (co_await printOne(args), ...);
+    }
+
+#if defined(__cpp_lib_format)
+    // 用 std::format_to_n 直接格式化到缓冲区空闲区；放不下时 flush 后重试，结果超过缓冲区容量时才退回临时字符串。
+    // 无界模式下链尾空间不足时按结果长度另备一段连续空间，再格式化一次
+    template <class... Args>
+    Task<> format(std::format_string<Args const&...> fmt, Args const&... args) {
+        checkFlushError();
+        if (mUnbounded) {
+            auto room = mPending.prepare();
+            auto size = static_cast<std::size_t>(std::format_to_n(room.data(), room.size(), fmt, args...).size);
+            if (size > room.size()) {
+                room = mPending.prepare_contiguous(size);
+                std::format_to_n(room.data(), size, fmt, args...);
+            }
+            mPending.commit(size);
+            markDirty();
+            co_return;
+        }
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            auto room = freeRegion();
+            auto res = std::format_to_n(room.data(), room.size(), fmt, args...);
+            if (static_cast<std::size_t>(res.size) <= room.size()) {
+                mIndex += res.size;
+                markDirty();
+                co_return;
+            }
+            if (static_cast<std::size_t>(res.size) > mBuffer.size()) {
+                break;
+            }
+            co_await flushBuffer(mAutoFlushLoop != nullptr);
+        }
+        co_await puts(std::format(fmt, args...));
+    }
+#else
+    // 没有 <format> 时的简化版：只支持不带格式说明的 {} 替换域和 {{、}} 转义，参数按 print 的方式转换
+    template <class... Args>
+    Task<> format(std::string_view fmt, Args const&... args) {
+        (co_await formatArg(fmt, args), ...);
+        bool extra = co_await formatLiteral(fmt);
+        if (extra) [[unlikely]] {
+            throw std::invalid_argument("format(): more replacement fields than arguments");
+        }
+    }
+#endif
+
+    Task<> flush() { return flushBuffer(false); }
+
+  private:
+    bool bufferFull() const noexcept { return mIndex == mBuffer.size(); }
+
+    void checkFlushError() const {
+        if (mFlushError) [[unlikely]] {
+            std::rethrow_exception(mFlushError);
+        }
+    }
+
+    std::span<char> freeRegion() {
+        if (!mBuffer.allocated()) [[unlikely]] {
+            mBuffer.acquire(streamBufferPool(static_cast<Writer*>(this)));
+        }
+        return {mBuffer.data() + mIndex, mBuffer.size() - mIndex};
+    }
+
+#if !defined(__cpp_lib_format)
+    // 写出 fmt 开头到下一个替换域为止的文字，返回是否遇到了替换域；fmt 前进到替换域之后
+    Task<bool> formatLiteral(std::string_view& fmt) {
+        while (!fmt.empty()) {
+            std::size_t i = fmt.find_first_of("{}");
+            co_await puts(fmt.substr(0, i));
+            if (i == fmt.npos) {
+                fmt = {};
+                break;
+            }
+            if (i + 1 < fmt.size() && fmt[i + 1] == fmt[i]) {
+                co_await putchar(fmt[i]);
+                fmt.remove_prefix(i + 2);
+                continue;
+            }
+            if (fmt[i] == '{' && i + 1 < fmt.size() && fmt[i + 1] == '}') {
+                fmt.remove_prefix(i + 2);
+                co_return true;
+            }
+            throw std::invalid_argument("format(): format specs need <format>");
+        }
+        co_return false;
+    }
+
+    // 与 std::format 一样，多余的参数被忽略
+    template <class T>
+    Task<> formatArg(std::string_view& fmt, T const& value) {
+        bool field = co_await formatLiteral(fmt);
+        if (field) {
+            co_await printOne(value);
+        }
+    }
+#endif
+
+    template <class T>
+    Task<> printOne(T const& value) {
+        if constexpr (std::same_as<T, char>) {
+            co_await putchar(value);
+        } else if constexpr (std::same_as<T, bool>) {
+            co_await puts(value ? "true" : "false");
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            char buf[64];
+            auto [ptr, ec] = std::to_chars(buf, buf + sizeof buf, value);
+            co_await puts(std::string_view(buf, ptr - buf));
+        } else {
+            static_assert(std::convertible_to<T const&, std::string_view>, "print() argument is not printable");
+            co_await puts(std::string_view(value));
         }
     }
 
-    Task<> flush() {
+    // 同一时刻只有一个协程在写出缓冲区，其余等待它完成；写出期间追加的数据由同一次 flush 一并写出
+    Task<> flushBuffer(bool more) {
         static_assert(
             requires(Writer * reader, std::span<const char> buffer) {
                 { reader->write(buffer) } -> std::same_as<Task<std::size_t>>;
             }, "Writer type must implement: Task<std::size_t> write(std::span<const char>)");
-        if (mIndex) [[likely]] {
-            auto* that = static_cast<Writer*>(this); // CRTP
-            auto buf = std::span(mBuffer.get(), mIndex);
-            auto len = co_await that->write(buf);
-            while (len != buf.size()) [[unlikely]] {
-                buf = buf.subspan(len);
-                len = co_await that->write(buf);
+        checkFlushError();
+        while (mFlushing) {
+            co_await mFlushDone.wait();
+        }
+        // 等待的那次 flush 可能已经失败
+        checkFlushError();
+        if (mIndex == 0 && mPending.empty()) {
+            co_return;
+        }
+        mFlushing = true;
+        auto* that = static_cast<Writer*>(this); // CRTP
+        try {
+            // 持有链首切片的引用，写出期间生产者追加的数据不会落在正在写出的内存块上
+            while (!mPending.empty()) {
+                BufferSlice front = mPending.slices().front();
+                mPending.consume(co_await that->write(front.span()));
+                if (mPending.size() <= mLowWatermark) {
+                    mWritable.notify_all();
+                }
             }
-            if (len == 0) [[unlikely]] {
-                throw EOFException();
+            while (mIndex) {
+                auto buf = std::span<const char>(mBuffer.data(), mIndex);
+                std::size_t len;
+                if constexpr (requires { that->write_more(buf); }) {
+                    len = more ? co_await that->write_more(buf) : co_await that->write(buf);
+                } else {
+                    len = co_await that->write(buf);
+                }
+                if (len != mIndex) [[unlikely]] {
+                    std::memmove(mBuffer.data(), mBuffer.data() + len, mIndex - len);
+                }
+                mIndex -= len;
             }
+        } catch (...) {
+            mFlushing = false;
+            // 连接已不可用：丢弃积压，免得生产者继续追加、反复发起注定失败的写出
+            mFlushError = std::current_exception();
+            mPending.clear();
             mIndex = 0;
+            mBuffer.release();
+            mWritable.notify_all();
+            mFlushDone.notify_all();
+            throw;
+        }
+        mFlushing = false;
+        if (mIndex == 0) {
+            mBuffer.release();
         }
+        mFlushDone.notify_all();
     }
 
-  private:
-    bool bufferFull() const noexcept { return mIndex == mBufSize; }
+    void markDirty() {
+        if (mFlushScheduled || mFlushError) {
+            return;
+        }
+        if (mUnbounded && !mFlushing && mPending.size() > mHighWatermark) {
+            scheduleFlush(false);
+        } else if (mAutoFlushLoop) {
+            scheduleFlush(true);
+        }
+    }
 
-    std::unique_ptr<char[]> mBuffer;
+    void scheduleFlush(bool atTickEnd) {
+        mFlushScheduled = true;
+        mAutoFlushTask = backgroundFlush(atTickEnd);
+        spawn_task(mAutoFlushTask);
+    }
+
+    Task<> backgroundFlush(bool atTickEnd) {
+        if (atTickEnd) {
+            co_await mAutoFlushLoop->tickEnd();
+        }
+        try {
+            co_await flush();
+        } catch (...) {
+            mFlushScheduled = false;
+            throw;
+        }
+        mFlushScheduled = false;
+    }
+
+    Storage mBuffer;
     std::size_t mIndex = 0;
-    std::size_t mBufSize = 0;
+    BufferChain mPending; // 无界缓冲模式下的待写数据
+    bool mUnbounded = false;
+    std::size_t mLowWatermark = 0;
+    std::size_t mHighWatermark = 0;
+    std::exception_ptr mFlushError;
+    WaitQueue mWritable;
+    bool mFlushing = false;
+    WaitQueue mFlushDone;
+    EpollLoop* mAutoFlushLoop = nullptr;
+    bool mFlushScheduled = false;
+    Task<> mAutoFlushTask; // 最后声明、最先析构：销毁流时取消尚未执行的后台 flush
 };
 
-template <class StreamBuf>
-struct IOStreamBase : IStreamBase<StreamBuf>, OStreamBase<StreamBuf> {
-    explicit IOStreamBase(std::size_t bufferSize = 8192)
-        : IStreamBase<StreamBuf>(bufferSize),
-          OStreamBase<StreamBuf>(bufferSize) {}
+// 双重映射只对输入有用，且映射保留到析构：输入用 MirroredBuffer 时，输出侧改用普通的池化缓冲区
+template <class Storage>
+using IOStreamOutputStorage = std::conditional_t<Storage::kMirrored, PooledBuffer, Storage>;
+
+template <class StreamBuf, class Storage = PooledBuffer>
+struct IOStreamBase : IStreamBase<StreamBuf, Storage>, OStreamBase<StreamBuf, IOStreamOutputStorage<Storage>> {
+    explicit IOStreamBase(std::size_t bufferSize = Storage::kDefaultSize)
+        : IStreamBase<StreamBuf, Storage>(bufferSize),
+          OStreamBase<StreamBuf, IOStreamOutputStorage<Storage>>(bufferSize) {}
 };
 
-template <class StreamBuf>
-struct [[nodiscard]] IOStream : IOStreamBase<IOStream<StreamBuf>>, StreamBuf {
+template <class StreamBuf, class Storage = PooledBuffer>
+struct [[nodiscard]] IOStream : IOStreamBase<IOStream<StreamBuf, Storage>, Storage>, StreamBuf {
     template <class... Args>
         requires std::constructible_from<StreamBuf, Args...>
-    explicit IOStream(Args&&... args) : IOStreamBase<IOStream<StreamBuf>>(),
+    explicit IOStream(Args&&... args) : IOStreamBase<IOStream<StreamBuf, Storage>, Storage>(),
                                         StreamBuf(std::forward<Args>(args)...) {}
     IOStream() = default;
 };
 
-template <class StreamBuf>
-struct [[nodiscard]] IStream : IStreamBase<IStream<StreamBuf>>, StreamBuf {
+template <class StreamBuf, class Storage = PooledBuffer>
+struct [[nodiscard]] IStream : IStreamBase<IStream<StreamBuf, Storage>, Storage>, StreamBuf {
     template <class... Args>
         requires std::constructible_from<StreamBuf, Args...>
-    explicit IStream(Args&&... args) : IStreamBase<IStream<StreamBuf>>(),
+    explicit IStream(Args&&... args) : IStreamBase<IStream<StreamBuf, Storage>, Storage>(),
                                        StreamBuf(std::forward<Args>(args)...) {}
     IStream() = default;
 };
 
-template <class StreamBuf>
-struct [[nodiscard]] OStream : OStreamBase<OStream<StreamBuf>>, StreamBuf {
+template <class StreamBuf, class Storage = PooledBuffer>
+struct [[nodiscard]] OStream : OStreamBase<OStream<StreamBuf, Storage>, Storage>, StreamBuf {
     template <class... Args>
         requires std::constructible_from<StreamBuf, Args...>
-    explicit OStream(Args&&... args) : OStreamBase<OStream<StreamBuf>>(),
+    explicit OStream(Args&&... args) : OStreamBase<OStream<StreamBuf, Storage>, Storage>(),
                                        StreamBuf(std::forward<Args>(args)...) {}
     OStream() = default;
 };
@@ -69,7 +69,10 @@ struct [[nodiscard]] Task {
 
     Task(std::coroutine_handle<promise_type> coroutine = nullptr) noexcept : mHandle(coroutine) {}
     Task(Task&& that) noexcept : mHandle(that.mHandle) { that.mHandle = nullptr; }
-    Task& operator=(Task&& that) noexcept { std::swap(mHandle, that.mHandle); }
+    Task& operator=(Task&& that) noexcept {
+        std::swap(mHandle, that.mHandle);
+        return *this;
+    }
     ~Task() {
         if (mHandle)
             mHandle.destroy();
@@ -105,4 +108,12 @@ void spawn_task(const Task<T, P>& t) {
     a.await_suspend(std::noop_coroutine()).resume();
 }
 
+// co_await DestroySelf()：销毁当前协程帧，不再返回。
+// 用于拥有者在协程运行途中被析构、协程只能自行结束的场合
+struct DestroySelf {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> coroutine) const noexcept { coroutine.destroy(); }
+    void await_resume() const noexcept {}
+};
+
 } // namespace co_async
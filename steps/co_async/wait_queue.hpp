@@ -0,0 +1,93 @@
+#pragma once
+
+#include <coroutine>
+
+namespace co_async {
+
+// 协程等待队列：co_await queue.wait() 挂起当前协程，notify_one()/notify_all() 依次就地恢复。
+// 等待者以侵入式链表节点的形式存放在各自的协程帧中，等待期间协程被销毁（如 when_any 的败者）时自动出队
+struct WaitQueue {
+    struct [[nodiscard]] Awaiter {
+        explicit Awaiter(WaitQueue* queue) noexcept : mTarget(queue) {}
+        Awaiter(Awaiter&&) = delete;
+        ~Awaiter() {
+            if (mQueue) {
+                mQueue->unlink(this);
+            }
+        }
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            mCoroutine = coroutine;
+            mTarget->link(this);
+        }
+        void await_resume() const noexcept {}
+
+      private:
+        friend struct WaitQueue;
+
+        WaitQueue* mTarget;
+        WaitQueue* mQueue = nullptr; // 当前所在的队列，未在等待时为空
+        Awaiter* mPrev = nullptr;
+        Awaiter* mNext = nullptr;
+        std::coroutine_handle<> mCoroutine;
+    };
+
+    WaitQueue() = default;
+    WaitQueue(WaitQueue&&) = delete;
+    ~WaitQueue() {
+        while (mHead) {
+            pop();
+        }
+    }
+
+    Awaiter wait() noexcept { return Awaiter(this); }
+
+    bool empty() const noexcept { return mHead == nullptr; }
+
+    void notify_one() {
+        if (mHead) {
+            pop().resume();
+        }
+    }
+
+    // 只唤醒调用时已在等待的协程，被唤醒者再次等待时要等下一次通知
+    void notify_all() {
+        WaitQueue pending;
+        for (Awaiter* p = mHead; p; p = p->mNext) {
+            p->mQueue = &pending;
+        }
+        pending.mHead = mHead;
+        pending.mTail = mTail;
+        mHead = mTail = nullptr;
+        while (pending.mHead) {
+            pending.pop().resume();
+        }
+    }
+
+  private:
+    void link(Awaiter* node) noexcept {
+        node->mQueue = this;
+        node->mPrev = mTail;
+        node->mNext = nullptr;
+        (mTail ? mTail->mNext : mHead) = node;
+        mTail = node;
+    }
+
+    void unlink(Awaiter* node) noexcept {
+        (node->mPrev ? node->mPrev->mNext : mHead) = node->mNext;
+        (node->mNext ? node->mNext->mPrev : mTail) = node->mPrev;
+        node->mQueue = nullptr;
+    }
+
+    std::coroutine_handle<> pop() noexcept {
+        Awaiter* node = mHead;
+        unlink(node);
+        return node->mCoroutine;
+    }
+
+    Awaiter* mHead = nullptr;
+    Awaiter* mTail = nullptr;
+};
+
+} // namespace co_async
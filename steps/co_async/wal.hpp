@@ -0,0 +1,245 @@
+#pragma once
+
+#include "crc32c.hpp"
+#include "framing.hpp"
+#include "offload_pool.hpp"
+#include "regular_file.hpp"
+#include "task.hpp"
+#include "timer_loop.hpp"
+#include "wait_queue.hpp"
+#include "when_any.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <sys/uio.h>
+#include <utility>
+#include <vector>
+
+namespace co_async {
+
+// 预写日志：co_await wal.append(record) 在记录落盘（fdatasync 完成）后才返回。
+// 同一提交窗口内各协程追加的记录合成一批，只做一次 pwritev + fdatasync，整批的等待者一起恢复；
+// 一批在写盘期间到达的记录进入下一批。窗口在攒够 maxBytes 字节或等待 delay 后结束，
+// delay 为零时只等到本轮事件处理完毕。
+// 每条记录为 4 字节小端长度 + 4 字节 CRC32C（覆盖长度和内容）+ 内容。
+// 一次写盘失败后文件状态不可知，之后的 append 都会抛出同一个错误
+struct Wal {
+    static constexpr std::size_t kHeaderSize = 8;
+
+    // 新记录追加在文件末尾；打开已有日志时应先 recover() 丢弃末尾不完整的记录
+    Wal(TimerLoop& timer, AsyncRegularFile file) : mTimer(timer), mFile(std::move(file)), mOffset(mFile.size()) {}
+    Wal(Wal&&) = delete;
+
+    void set_commit_window(std::size_t maxBytes, std::chrono::system_clock::duration delay) {
+        mMaxBytes = maxBytes;
+        mDelay = delay;
+    }
+
+    // 下一条记录的写入位置
+    off_t offset() const noexcept { return mOffset; }
+    AsyncRegularFile& file() noexcept { return mFile; }
+
+    // 返回记录在文件中的起始位置。record 指向的数据在返回前不能改动，写盘时直接引用而不复制。
+    // 长度字段只有 32 位，4 GiB 及以上的记录抛出 std::length_error，不写入任何内容。
+    // 一批中第一个追加的协程负责提交整批，因此 append 开始后不能中途销毁
+    Task<off_t> append(std::string_view record) {
+        if (mError) [[unlikely]] {
+            std::rethrow_exception(mError);
+        }
+        if (record.size() > UINT32_MAX) [[unlikely]] {
+            throw std::length_error("WAL record exceeds the 32-bit length field");
+        }
+        auto batch = mBatch;
+        off_t offset = mOffset;
+        batch->add(record);
+        mOffset += kHeaderSize + record.size();
+        if (batch->mRecords.size() == 1) {
+            co_await commit(batch, offset);
+        } else if (batch->mBytes >= mMaxBytes) {
+            mFull.notify_one();
+        }
+        while (!batch->mCommitted) {
+            co_await batch->mDone.wait();
+        }
+        if (batch->mError) [[unlikely]] {
+            std::rethrow_exception(batch->mError);
+        }
+        co_return offset;
+    }
+
+    // 从头扫描日志，对每条完整且校验通过的记录调用 onRecord(std::string_view)，
+    // 遇到第一条不完整或校验失败的记录即停止，把文件截断到此处，之后的 append 从这里继续。
+    // 返回有效记录数
+    template <class F>
+    Task<std::size_t> recover(F onRecord) {
+        std::size_t fileSize = mFile.size();
+        std::vector<char> buf;
+        std::size_t base = 0;  // buf[0] 在文件中的位置
+        std::size_t start = 0; // buf 中下一条记录的起点
+        std::size_t count = 0;
+        while (true) {
+            std::size_t need = kHeaderSize;
+            bool torn = false; // 遇到写到一半或校验失败的记录
+            while (buf.size() - start >= kHeaderSize) {
+                std::uint32_t len = loadFixed<std::uint32_t>(buf.data() + start);
+                if (base + start + kHeaderSize + len > fileSize) {
+                    torn = true;
+                    break;
+                }
+                need = kHeaderSize + len;
+                if (buf.size() - start < need) {
+                    break;
+                }
+                auto payload = std::string_view(buf.data() + start + kHeaderSize, len);
+                if (loadFixed<std::uint32_t>(buf.data() + start + 4) != checksum(buf.data() + start, payload)) {
+                    torn = true;
+                    break;
+                }
+                onRecord(payload);
+                ++count;
+                start += need;
+                need = kHeaderSize;
+            }
+            if (torn) {
+                break;
+            }
+            buf.erase(buf.begin(), buf.begin() + start);
+            base += start;
+            start = 0;
+            std::size_t old = buf.size();
+            buf.resize(old + std::max<std::size_t>(need, kRecoverChunk));
+            std::size_t len = co_await mFile.pread(base + old, std::span(buf.data() + old, buf.size() - old));
+            buf.resize(old + len);
+            if (len == 0) {
+                break;
+            }
+        }
+        mOffset = base + start;
+        if (static_cast<std::size_t>(mOffset) != fileSize) {
+            co_await mFile.truncate(mOffset);
+        }
+        co_return count;
+    }
+
+  private:
+    static constexpr std::size_t kRecoverChunk = 65536;
+
+    // 一个提交窗口内的全部记录
+    struct Batch {
+        std::vector<std::array<char, kHeaderSize>> mHeaders;
+        std::vector<std::string_view> mRecords;
+        std::size_t mBytes = 0;
+        bool mCommitted = false;
+        std::exception_ptr mError;
+        WaitQueue mDone;
+
+        void add(std::string_view record) {
+            auto& header = mHeaders.emplace_back();
+            storeFixed<std::uint32_t>(header.data(), record.size());
+            storeFixed(header.data() + 4, checksum(header.data(), record));
+            mRecords.push_back(record);
+            mBytes += kHeaderSize + record.size();
+        }
+    };
+
+    // 长度字段也计入校验和，损坏的长度不会被当作合法记录
+    static std::uint32_t checksum(char const* header, std::string_view payload) noexcept {
+        return crc32c(payload, crc32c(std::span(header, 4)));
+    }
+
+    // 写完全部 iovec 才返回，超过 IOV_MAX 时分多次 pwritev
+    static ssize_t writevAll(int fd, off_t offset, std::span<struct iovec> iov) noexcept {
+        std::size_t done = 0;
+        while (!iov.empty()) {
+            ssize_t len = ::pwritev(fd, iov.data(), std::min<std::size_t>(iov.size(), IOV_MAX), offset + done);
+            if (len == -1) {
+                return -1;
+            }
+            done += len;
+            // 跳过已写完的 iovec，写了一部分的那个调整起点
+            std::size_t n = len;
+            while (!iov.empty() && n >= iov.front().iov_len) {
+                n -= iov.front().iov_len;
+                iov = iov.subspan(1);
+            }
+            if (n) {
+                iov.front().iov_base = static_cast<char*>(iov.front().iov_base) + n;
+                iov.front().iov_len -= n;
+            }
+        }
+        return done;
+    }
+
+    Task<> waitFull() { co_await mFull.wait(); }
+
+    // 由一批的第一个协程执行：等上一批写完、等提交窗口结束，然后写入整批并唤醒其余等待者。
+    // 唤醒等待者可能导致 Wal 被析构，此后只访问 batch
+    Task<> commit(std::shared_ptr<Batch> batch, off_t offset) {
+        bool waited = false;
+        while (mWriting) {
+            waited = true;
+            co_await mIdle.wait();
+        }
+        // 上一批写盘期间已经攒下的记录直接提交，不再额外等待
+        if (!waited && !mError && batch->mBytes < mMaxBytes) {
+            if (mDelay.count() > 0) {
+                co_await when_any(sleep_for(mTimer, mDelay), waitFull());
+            } else {
+                co_await mFile.pool().loop().tickEnd();
+            }
+        }
+        mBatch = std::make_shared<Batch>();
+        if (mError) [[unlikely]] {
+            batch->mError = mError;
+        } else {
+            mWriting = true;
+            try {
+                co_await writeBatch(*batch, offset);
+            } catch (...) {
+                batch->mError = mError = std::current_exception();
+            }
+            mWriting = false;
+        }
+        batch->mCommitted = true;
+        mIdle.notify_one();
+        batch->mDone.notify_all();
+    }
+
+    Task<> writeBatch(Batch& batch, off_t offset) {
+        std::vector<struct iovec> iov;
+        iov.reserve(batch.mRecords.size() * 2);
+        for (std::size_t i = 0; i < batch.mRecords.size(); ++i) {
+            iov.push_back({batch.mHeaders[i].data(), kHeaderSize});
+            iov.push_back({const_cast<char*>(batch.mRecords[i].data()), batch.mRecords[i].size()});
+        }
+        int fd = mFile.fileNo();
+        // 写入和 fdatasync 在同一次工作线程调用中完成，只往返 loop 一次
+        checkError(co_await offload(mFile.pool(), [&]() -> ssize_t {
+            if (writevAll(fd, offset, iov) == -1) {
+                return -1;
+            }
+            return ::fdatasync(fd);
+        }));
+    }
+
+    TimerLoop& mTimer;
+    AsyncRegularFile mFile;
+    off_t mOffset;
+    std::size_t mMaxBytes = std::size_t(1) << 20;
+    std::chrono::system_clock::duration mDelay{};
+    std::shared_ptr<Batch> mBatch = std::make_shared<Batch>();
+    WaitQueue mFull;
+    WaitQueue mIdle;
+    bool mWriting = false;
+    std::exception_ptr mError;
+};
+
+} // namespace co_async
@@ -86,23 +86,28 @@ auto when_all(Ts&&... ts) {
 }
 
 template <Awaitable T, class Alloc = std::allocator<T>>
-Task<std::conditional_t<std::same_as<void, typename AwaitableTraits<T>::RetType>,
-                        std::vector<typename AwaitableTraits<T>::RetType, Alloc>,
+Task<std::conditional_t<!std::same_as<void, typename AwaitableTraits<T>::RetType>,
+                        std::vector<typename AwaitableTraits<T>::RetType,
+                                    typename std::allocator_traits<Alloc>::template rebind_alloc<
+                                        typename AwaitableTraits<T>::NonVoidRetType>>,
                         void>>
 when_all(const std::vector<T, Alloc>& tasks) {
+    using RetType = typename AwaitableTraits<T>::RetType;
+    using Traits = std::allocator_traits<Alloc>;
     WhenAllCtlBlock ctl{tasks.size()};
-    Alloc alloc = tasks.get_allocator();
-    std::vector<Uninitialized<typename AwaitableTraits<T>::RetType>, Alloc> result(tasks.size(), alloc);
+    std::vector<Uninitialized<RetType>, typename Traits::template rebind_alloc<Uninitialized<RetType>>> result(
+        tasks.size(), tasks.get_allocator());
     {
-        std::vector<ReturnPreviousTask, Alloc> taskArray(alloc);
+        std::vector<ReturnPreviousTask, typename Traits::template rebind_alloc<ReturnPreviousTask>> taskArray(
+            tasks.get_allocator());
         taskArray.reserve(tasks.size());
         for (std::size_t i = 0; i < tasks.size(); ++i) {
             taskArray.push_back(whenAllHelper(tasks[i], ctl, result[i]));
         }
         co_await WhenAllAwaiter(ctl, taskArray);
     }
-    if constexpr (!std::same_as<void, typename AwaitableTraits<T>::RetType>) {
-        std::vector<typename AwaitableTraits<T>::RetType, Alloc> res(alloc);
+    if constexpr (!std::same_as<void, RetType>) {
+        std::vector<RetType, typename Traits::template rebind_alloc<RetType>> res(tasks.get_allocator());
         res.reserve(tasks.size());
         for (auto& r : result) {
             res.push_back(r.moveValue());
@@ -1,57 +1,56 @@
 #include "co_async/async_loop.hpp"
-#include "co_async/debug.hpp"
+#include "co_async/http_client.hpp"
 #include "co_async/socket.hpp"
+#include "co_async/when_all.hpp"
 
-#include <termios.h>
+#include <iostream>
+#include <string>
+#include <vector>
 
-[[gnu::constructor]] static void disable_canon() {
-    struct termios tc;
-    tcgetattr(STDIN_FILENO, &tc);
-    tc.c_lflag &= ~ICANON;
-    tc.c_lflag &= ~ECHO;
-    tcsetattr(STDIN_FILENO, TCSANOW, &tc);
-}
+// HTTP/1.1 客户端：连接池中的连接保持复用，同一连接上的并发请求组成流水线；
+// 正文按 Content-Length 或 chunked 解码，可以一次读完，也可以用生成器边到边读
 
 using namespace std::literals;
 
 co_async::AsyncLoop loop;
 
+co_async::Task<std::string> fetch_uuid(co_async::HttpClient& client) {
+    auto response = co_await client.get("/uuid");
+    co_return co_await response.read_body();
+}
+
 co_async::Task<> amain() {
-    auto sock = co_await create_tcp_client(loop, co_async::socket_address(co_async::ip_address("httpbin.org"), 80));
-    std::string http_request =
-        "GET /get?param1=value1&param2=value2 HTTP/1.1\r\n"
-        "Host: httpbin.org\r\n"
-        "User-Agent: my_co_async-client/1.0\r\n"
-        "Accept: */*\r\n"
-        "Connection: close\r\n"
-        "\r\n";
-    co_await write_file(loop, sock, http_request);
-    char buf[4096];
-    auto len = co_await read_file(loop, sock, buf);
-    std::string_view response(buf, len);
-    size_t header_end = response.find("\r\n\r\n");
-    if (header_end != std::string_view::npos) {
-        std::string_view headers = response.substr(0, header_end);
-        std::string_view body = response.substr(header_end + 4);
-        
-        std::cout << "=== 响应头 ===\n" << headers << "\n\n";
-        std::cout << "=== 响应体 ===\n" << body << std::endl;
-    } else {
-        std::cout << response;
+    co_async::HttpClient client(loop, co_async::socket_address(co_async::ip_address("httpbin.org"), 80),
+                                "httpbin.org", 2);
+    co_async::HttpHeader headers[] = {
+        {"user-agent", "my_co_async-client/1.0"},
+        {"accept", "*/*"},
+    };
+
+    auto response = co_await client.get("/get?param1=value1&param2=value2", headers);
+    std::cout << "=== 响应头 ===\n" << response.mStatus << " " << response.mReason << "\n";
+    for (auto const& h : response.mHeaders) {
+        std::cout << h.mName << ": " << h.mValue << "\n";
+    }
+    std::cout << "\n=== 响应体 ===\n" << co_await response.read_body() << "\n";
+
+    // chunked 编码的正文逐段到达
+    auto stream = co_await client.get("/stream/3", headers);
+    std::cout << "=== 流式正文 ===\n";
+    auto chunks = stream.body_stream();
+    while (auto chunk = co_await chunks) {
+        std::cout << *chunk;
+    }
+
+    // 并发请求复用池中的连接（最多两条），每条连接上的请求流水线发出
+    std::vector<co_async::Task<std::string>> tasks;
+    for (int i = 0; i < 6; ++i) {
+        tasks.push_back(fetch_uuid(client));
+    }
+    for (auto const& uuid : co_await co_async::when_all(tasks)) {
+        std::cout << uuid;
     }
-    // // 解析响应，检查是否为 301/302 重定向
-    // if (response.find("HTTP/1.1 301") != std::string_view::npos ||
-    //     response.find("HTTP/1.1 302") != std::string_view::npos) {
-    //     // 提取 location 头中的新 URL
-    //     size_t loc_start = response.find("location: ");
-    //     if (loc_start != std::string_view::npos) {
-    //         loc_start += 10; // "location: " 的长度
-    //         size_t loc_end = response.find("\r\n", loc_start);
-    //         std::string_view new_location = response.substr(loc_start, loc_end - loc_start);
-    //         std::cout << "重定向到: " << new_location << std::endl;
-    //     }
-    // }
-    co_return;
+    std::cout << "使用了 " << client.connection_count() << " 条连接\n";
 }
 
 int main() {
@@ -0,0 +1,84 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/debug.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sys/socket.h>
+
+// 流层开销基准：同样的一问一答和批量传输，分别跑在进程内管道（PipeStream）和 socketpair（FileStream）上，
+// 两者之差即内核 I/O 的代价
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+constexpr std::size_t kRoundTrips = 100000;
+constexpr std::size_t kBulkBytes = std::size_t(256) << 20;
+constexpr std::size_t kChunk = 16384;
+
+void report(const char* name, std::size_t count, const char* unit, std::chrono::steady_clock::duration elapsed) {
+    double secs = std::chrono::duration<double>(elapsed).count();
+    std::cout << name << ": " << static_cast<std::size_t>(count / secs) << " " << unit << "\n";
+}
+
+template <class Stream>
+co_async::Task<> echo_server(Stream& s) {
+    for (std::size_t i = 0; i < kRoundTrips; ++i) {
+        auto line = co_await s.getline('\n');
+        co_await s.puts(line);
+        co_await s.putchar('\n');
+        co_await s.flush();
+    }
+}
+
+template <class Stream>
+co_async::Task<> ping_client(Stream& s, const char* name) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < kRoundTrips; ++i) {
+        co_await s.puts("PING\n");
+        co_await s.flush();
+        (void)co_await s.getline('\n');
+    }
+    report(name, kRoundTrips, "次往返/秒", std::chrono::steady_clock::now() - t0);
+}
+
+template <class Stream>
+co_async::Task<> bulk_sender(Stream& s) {
+    std::string chunk(kChunk, 'x');
+    for (std::size_t sent = 0; sent < kBulkBytes; sent += kChunk) {
+        co_await s.puts(chunk);
+    }
+    co_await s.flush();
+}
+
+template <class Stream>
+co_async::Task<> bulk_receiver(Stream& s, const char* name) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t got = 0; got < kBulkBytes; got += kChunk) {
+        (void)co_await s.getn(kChunk);
+    }
+    report(name, (kBulkBytes >> 20), "MiB/秒", std::chrono::steady_clock::now() - t0);
+}
+
+co_async::Task<> amain() {
+    {
+        auto [a, b] = co_async::make_pipe(loop);
+        co_async::PipeStream client(std::move(a)), server(std::move(b));
+        co_await co_async::when_all(echo_server(server), ping_client(client, "PipeStream 往返"));
+        co_await co_async::when_all(bulk_sender(client), bulk_receiver(server, "PipeStream 批量"));
+    }
+    {
+        int fds[2];
+        co_async::checkError(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+        co_async::FileStream client(loop, co_async::AsyncFile(fds[0])), server(loop, co_async::AsyncFile(fds[1]));
+        co_await co_async::when_all(echo_server(server), ping_client(client, "socketpair 往返"));
+        co_await co_async::when_all(bulk_sender(client), bulk_receiver(server, "socketpair 批量"));
+    }
+}
+
+int main() {
+    run_task(loop, amain());
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/rpc.hpp"
+#include "co_async/socket.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+#include "co_async/when_any.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// 多路复用 RPC：所有调用共用一条 TCP 连接，响应按处理完成的先后乱序返回
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+constexpr int kPort = 23456;
+constexpr std::size_t kCallers = 64;
+constexpr std::size_t kCallsPerCaller = 2000;
+
+co_async::Task<> server_main(co_async::AsyncFile& listener) {
+    co_async::RpcServer server;
+    server.add_method("echo", [](std::string_view body) -> co_async::Task<std::string> {
+        co_return std::string(body);
+    });
+    // 正文为毫秒数，睡眠后原样返回
+    server.add_method("sleep", [](std::string_view body) -> co_async::Task<std::string> {
+        std::string ms(body);
+        co_await co_async::sleep_for(loop, std::chrono::milliseconds(std::stoi(ms)));
+        co_return ms;
+    });
+    server.add_method("fail", [](std::string_view) -> co_async::Task<std::string> {
+        throw std::runtime_error("handler failed");
+        co_return std::string();
+    });
+    auto [sock, addr] = co_await co_async::socket_accept<co_async::IpAddress>(loop, listener);
+    co_async::FileStream stream(loop, std::move(sock));
+    co_await server.serve(loop, stream);
+}
+
+template <class Client>
+co_async::Task<> sleeper(Client& client, const char* ms) {
+    auto reply = co_await client.call("sleep", ms);
+    std::cout << "sleep " << reply << "ms 返回\n";
+}
+
+template <class Client>
+co_async::Task<std::size_t> echo_caller(Client& client) {
+    for (std::size_t i = 0; i < kCallsPerCaller; ++i) {
+        (void)co_await client.call("echo", "ping");
+    }
+    co_return kCallsPerCaller;
+}
+
+co_async::Task<> client_main() {
+    auto sock = co_await co_async::create_tcp_client(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort));
+    co_async::FileStream stream(loop, std::move(sock));
+    co_async::RpcClient client(loop, loop, stream);
+
+    // 后发出的短调用先返回
+    co_await co_async::when_all(sleeper(client, "30"), sleeper(client, "10"), sleeper(client, "20"));
+
+    try {
+        co_await client.call("sleep", "200", 50ms);
+    } catch (std::system_error const& e) {
+        std::cout << "超时: " << e.what() << "\n";
+    }
+    // 调用在外部被取消（when_any 中计时器先到）：之后到达的响应被丢弃，客户端照常可用
+    auto cancelled = co_await co_async::when_any(client.call("sleep", "100"), co_async::sleep_for(loop, 20ms));
+    co_await co_async::sleep_for(loop, 150ms);
+    std::cout << "取消: " << (cancelled.index() == 1 ? "调用被取消" : "调用先完成") << "，之后 echo 返回 "
+              << co_await client.call("echo", "still alive") << "\n";
+    try {
+        co_await client.call("fail", "");
+    } catch (co_async::RpcError const& e) {
+        std::cout << "远端错误: " << e.what() << "\n";
+    }
+
+    std::vector<co_async::Task<std::size_t>> callers;
+    for (std::size_t i = 0; i < kCallers; ++i) {
+        callers.push_back(echo_caller(client));
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    auto counts = co_await co_async::when_all(callers);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << kCallers << " 个并发调用者: " << static_cast<std::size_t>(counts.size() * kCallsPerCaller / secs)
+              << " 次调用/秒\n";
+}
+
+co_async::Task<> amain() {
+    auto listener = co_await co_async::create_tcp_server(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort));
+    co_async::socket_listen(listener);
+    co_await co_async::when_all(server_main(listener), client_main());
+}
+
+int main() {
+    run_task(loop, amain());
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/resp.hpp"
+#include "co_async/socket.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Redis 客户端：多个协程并发发出的命令在同一轮里合并为一次写出，回复按顺序交还。
+// 对端是进程内的一个简易 RESP 服务器，只支持演示用到的几条命令
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+constexpr int kPort = 23458;
+constexpr std::size_t kSequential = 20000;
+constexpr std::size_t kCallers = 64;
+constexpr std::size_t kCallsPerCaller = 2000;
+
+co_async::RespValue simple(co_async::RespType type, std::string s) {
+    co_async::RespValue v;
+    v.mType = type;
+    v.mString = std::move(s);
+    return v;
+}
+
+co_async::RespValue integer(std::int64_t n) {
+    co_async::RespValue v;
+    v.mType = co_async::RespType::Integer;
+    v.mInteger = n;
+    return v;
+}
+
+co_async::RespValue execute(std::unordered_map<std::string, std::string>& db, std::vector<co_async::RespValue>& argv) {
+    using co_async::RespType;
+    std::string cmd = argv.empty() ? "" : argv[0].mString;
+    for (auto& c : cmd) {
+        c = std::toupper(static_cast<unsigned char>(c));
+    }
+    if (cmd == "PING") {
+        return simple(RespType::SimpleString, "PONG");
+    } else if (cmd == "SET" && argv.size() == 3) {
+        db.insert_or_assign(std::move(argv[1].mString), std::move(argv[2].mString));
+        return simple(RespType::SimpleString, "OK");
+    } else if (cmd == "GET" && argv.size() == 2) {
+        auto it = db.find(argv[1].mString);
+        return it == db.end() ? co_async::RespValue() : simple(RespType::BulkString, it->second);
+    } else if (cmd == "INCR" && argv.size() == 2) {
+        auto& s = db[argv[1].mString];
+        s = std::to_string((s.empty() ? 0 : std::stoll(s)) + 1);
+        return integer(std::stoll(s));
+    } else if (cmd == "HELLO") {
+        co_async::RespValue v;
+        v.mType = RespType::Map;
+        v.mElements.push_back(simple(RespType::BulkString, "server"));
+        v.mElements.push_back(simple(RespType::BulkString, "fake"));
+        v.mElements.push_back(simple(RespType::BulkString, "proto"));
+        v.mElements.push_back(integer(3));
+        return v;
+    }
+    return simple(RespType::Error, "ERR unknown command '" + cmd + "'");
+}
+
+co_async::Task<> server_main(co_async::AsyncFile& listener) {
+    auto [sock, addr] = co_await co_async::socket_accept<co_async::IpAddress>(loop, listener);
+    co_async::FileStream stream(loop, std::move(sock));
+    // 与客户端一样：一批流水线命令的回复在本轮结束时一次写出
+    stream.set_auto_flush(loop);
+    stream.set_watermarks(64 * 1024, 1024 * 1024);
+    std::unordered_map<std::string, std::string> db;
+    while (true) {
+        co_async::RespValue request;
+        try {
+            request = co_await co_async::read_resp(stream);
+        } catch (co_async::EOFException const&) {
+            break;
+        }
+        co_await stream.writable();
+        co_await co_async::write_resp(stream, execute(db, request.mElements));
+    }
+}
+
+template <class Client>
+co_async::Task<std::size_t> getter(Client& client) {
+    for (std::size_t i = 0; i < kCallsPerCaller; ++i) {
+        (void)co_await client.command("GET", "counter");
+    }
+    co_return kCallsPerCaller;
+}
+
+void report(const char* name, std::size_t count, std::chrono::steady_clock::duration elapsed) {
+    double secs = std::chrono::duration<double>(elapsed).count();
+    std::cout << name << ": " << static_cast<std::size_t>(count / secs) << " 条命令/秒\n";
+}
+
+co_async::Task<> client_main() {
+    auto sock = co_await co_async::create_tcp_client(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort));
+    co_async::FileStream stream(loop, std::move(sock));
+    co_async::RespClient client(loop, stream);
+
+    auto hello = co_await client.command("HELLO", 3);
+    std::cout << "HELLO 返回 " << hello.mElements.size() / 2 << " 个字段\n";
+    co_await client.command("SET", "greeting", "hello");
+    auto greeting = co_await client.command("GET", "greeting");
+    std::cout << "GET greeting = " << greeting.mString << "\n";
+    auto missing = co_await client.command("GET", "missing");
+    std::cout << "GET missing 为空: " << std::boolalpha << missing.is_null() << "\n";
+    // 三条命令在同一轮里发出，合并为一次写出
+    auto [a, b, c] = co_await co_async::when_all(client.command("INCR", "counter"), client.command("INCR", "counter"),
+                                                 client.command("INCR", "counter"));
+    std::cout << "INCR: " << a.mInteger << " " << b.mInteger << " " << c.mInteger << "\n";
+    try {
+        co_await client.command("FLUSHALL");
+    } catch (co_async::RespError const& e) {
+        std::cout << "错误回复: " << e.what() << "\n";
+    }
+
+    // 一次只发一条命令：每条都要等一个往返
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < kSequential; ++i) {
+        (void)co_await client.command("GET", "counter");
+    }
+    report("逐条往返", kSequential, std::chrono::steady_clock::now() - t0);
+
+    // 多个协程并发：同一轮的命令自动组成流水线
+    std::vector<co_async::Task<std::size_t>> callers;
+    for (std::size_t i = 0; i < kCallers; ++i) {
+        callers.push_back(getter(client));
+    }
+    t0 = std::chrono::steady_clock::now();
+    auto counts = co_await co_async::when_all(callers);
+    report("64 个并发协程", counts.size() * kCallsPerCaller, std::chrono::steady_clock::now() - t0);
+}
+
+co_async::Task<> amain() {
+    auto listener = co_await co_async::create_tcp_server(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort));
+    co_async::socket_listen(listener);
+    co_await co_async::when_all(server_main(listener), client_main());
+}
+
+int main() {
+    run_task(loop, amain());
+    return 0;
+}
@@ -0,0 +1,650 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/socket.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+#include "co_async/when_any.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <thread>
+#include <vector>
+
+// 兼容 memcached 文本协议的缓存服务器，作为 loop 和流层的压测负载：
+// get（含多键）、set/add/replace、delete、flush_all、version、quit。
+// 数据按键的哈希分片，每个分片有自己的锁、链式哈希表、slab 分配器和按 slab 类划分的 LRU；
+// 每个核一个线程、一个 loop，各自的监听套接字通过 SO_REUSEPORT 共用端口。
+// 不带参数运行时在本进程内启动压测客户端并报告每秒操作数；带 serve 参数时只作为服务器运行
+
+using namespace std::literals;
+
+constexpr int kPort = 11311;
+constexpr std::size_t kShards = 16;
+constexpr std::size_t kMemoryLimit = std::size_t(256) << 20;
+constexpr std::size_t kSlabPageSize = std::size_t(1) << 20;
+constexpr std::size_t kMaxKeySize = 250;
+constexpr std::size_t kMaxTokens = 64;
+
+// 一个缓存项连同键和数据放在同一个 slab 块中：Item 头、键、数据（末尾带 \r\n，可直接写出）
+struct Item {
+    Item* mHashNext;
+    Item* mPrev; // LRU 中较新的一项
+    Item* mNext; // LRU 中较旧的一项
+    std::int64_t mExpire; // Unix 秒，0 表示不过期
+    std::uint32_t mFlags;
+    std::uint32_t mBytes; // 数据长度，不含 \r\n
+    std::uint32_t mRefs;  // 正在被写出的次数，为 0 时才能释放
+    std::uint8_t mKeyLen;
+    std::uint8_t mClass;
+    bool mLinked; // 仍在哈希表和 LRU 中
+
+    char* key() noexcept { return reinterpret_cast<char*>(this + 1); }
+    std::string_view key_view() noexcept { return {key(), mKeyLen}; }
+    char* data() noexcept { return key() + mKeyLen; }
+    std::string_view data_with_crlf() noexcept { return {data(), mBytes + 2}; }
+};
+
+// slab 类：块大小从 64 字节起按 1.25 倍递增，最后一类占满整页
+inline std::vector<std::size_t> const kSlabClasses = [] {
+    std::vector<std::size_t> sizes;
+    for (double size = 64; size < kSlabPageSize / 1.25; size *= 1.25) {
+        sizes.push_back((static_cast<std::size_t>(size) + 7) & ~std::size_t(7));
+    }
+    sizes.push_back(kSlabPageSize);
+    return sizes;
+}();
+
+// 按页向系统申请内存，切成同样大小的块放进各类的空闲链表；达到内存上限后只能复用已释放的块
+struct SlabAllocator {
+    explicit SlabAllocator(std::size_t limit) : mLimit(limit), mFree(kSlabClasses.size()) {}
+
+    static int classFor(std::size_t size) noexcept {
+        auto it = std::lower_bound(kSlabClasses.begin(), kSlabClasses.end(), size);
+        return it == kSlabClasses.end() ? -1 : static_cast<int>(it - kSlabClasses.begin());
+    }
+
+    Item* allocate(int cls) {
+        auto& head = mFree[cls];
+        if (!head && mUsed + kSlabPageSize <= mLimit) {
+            auto& page = mPages.emplace_back(std::make_unique<char[]>(kSlabPageSize));
+            mUsed += kSlabPageSize;
+            std::size_t chunk = kSlabClasses[cls];
+            for (std::size_t off = 0; off + chunk <= kSlabPageSize; off += chunk) {
+                auto* item = reinterpret_cast<Item*>(page.get() + off);
+                item->mHashNext = head;
+                head = item;
+            }
+        }
+        Item* item = head;
+        if (item) {
+            head = item->mHashNext;
+        }
+        return item;
+    }
+
+    void deallocate(Item* item) noexcept {
+        item->mHashNext = mFree[item->mClass];
+        mFree[item->mClass] = item;
+    }
+
+  private:
+    std::size_t mLimit;
+    std::size_t mUsed = 0;
+    std::vector<std::unique_ptr<char[]>> mPages;
+    std::vector<Item*> mFree; // 空闲块借用 mHashNext 串成链表
+};
+
+struct Lru {
+    Item* mHead = nullptr; // 最近使用
+    Item* mTail = nullptr; // 最久未使用
+
+    void push_front(Item* item) noexcept {
+        item->mPrev = nullptr;
+        item->mNext = mHead;
+        (mHead ? mHead->mPrev : mTail) = item;
+        mHead = item;
+    }
+
+    void erase(Item* item) noexcept {
+        (item->mPrev ? item->mPrev->mNext : mHead) = item->mNext;
+        (item->mNext ? item->mNext->mPrev : mTail) = item->mPrev;
+    }
+};
+
+// 分片：以下所有操作都要在持有 mMutex 时进行
+struct Shard {
+    std::mutex mMutex;
+
+    Shard() : mSlabs(kMemoryLimit / kShards), mLru(kSlabClasses.size()), mBuckets(1024) {}
+
+    Item* find(std::string_view key, std::size_t hash, std::int64_t now) {
+        Item** slot = &mBuckets[hash & (mBuckets.size() - 1)];
+        for (Item* item = *slot; item; item = item->mHashNext) {
+            if (item->key_view() == key) {
+                if (item->mExpire && item->mExpire <= now) {
+                    unlink(item); // 惰性淘汰过期项
+                    return nullptr;
+                }
+                return item;
+            }
+        }
+        return nullptr;
+    }
+
+    // 取用：移到 LRU 头部并增加引用，写出后调用 release
+    void acquire(Item* item) noexcept {
+        auto& lru = mLru[item->mClass];
+        lru.erase(item);
+        lru.push_front(item);
+        ++item->mRefs;
+    }
+
+    void release(Item* item) noexcept {
+        if (--item->mRefs == 0 && !item->mLinked) {
+            mSlabs.deallocate(item);
+        }
+    }
+
+    // 分配失败时从同一 slab 类的 LRU 尾部淘汰未被引用的项后重试；返回 nullptr 表示内存不足
+    Item* allocate(std::string_view key, std::size_t bytes) {
+        int cls = SlabAllocator::classFor(sizeof(Item) + key.size() + bytes + 2);
+        if (cls < 0) {
+            return nullptr;
+        }
+        Item* item = mSlabs.allocate(cls);
+        for (Item* victim = mLru[cls].mTail; !item && victim; victim = mLru[cls].mTail) {
+            for (int tries = 0; victim && victim->mRefs; ++tries) {
+                victim = tries < 5 ? victim->mPrev : nullptr;
+            }
+            if (!victim) {
+                break;
+            }
+            unlink(victim);
+            item = mSlabs.allocate(cls);
+        }
+        if (item) {
+            item->mRefs = 0;
+            item->mLinked = false;
+            item->mClass = static_cast<std::uint8_t>(cls);
+            item->mKeyLen = static_cast<std::uint8_t>(key.size());
+            item->mBytes = static_cast<std::uint32_t>(bytes);
+            std::memcpy(item->key(), key.data(), key.size());
+        }
+        return item;
+    }
+
+    // 放入哈希表，替换同键的旧项
+    void link(Item* item, std::size_t hash) {
+        if (Item* old = find(item->key_view(), hash, 0)) {
+            unlink(old);
+        }
+        if (mCount >= mBuckets.size() * 3 / 2) {
+            rehash();
+        }
+        Item*& head = mBuckets[hash & (mBuckets.size() - 1)];
+        item->mHashNext = head;
+        head = item;
+        item->mLinked = true;
+        mLru[item->mClass].push_front(item);
+        ++mCount;
+    }
+
+    void unlink(Item* item) {
+        Item** slot = &mBuckets[std::hash<std::string_view>()(item->key_view()) & (mBuckets.size() - 1)];
+        while (*slot != item) {
+            slot = &(*slot)->mHashNext;
+        }
+        *slot = item->mHashNext;
+        mLru[item->mClass].erase(item);
+        item->mLinked = false;
+        --mCount;
+        if (item->mRefs == 0) {
+            mSlabs.deallocate(item);
+        }
+    }
+
+    void clear() {
+        for (auto& lru : mLru) {
+            while (lru.mHead) {
+                unlink(lru.mHead);
+            }
+        }
+    }
+
+  private:
+    void rehash() {
+        std::vector<Item*> buckets(mBuckets.size() * 2);
+        for (Item* head : mBuckets) {
+            while (head) {
+                Item* next = head->mHashNext;
+                Item*& slot = buckets[std::hash<std::string_view>()(head->key_view()) & (buckets.size() - 1)];
+                head->mHashNext = slot;
+                slot = head;
+                head = next;
+            }
+        }
+        mBuckets = std::move(buckets);
+    }
+
+    SlabAllocator mSlabs;
+    std::vector<Lru> mLru;
+    std::vector<Item*> mBuckets;
+    std::size_t mCount = 0;
+};
+
+// 分片选择用哈希的高位，桶选择用低位
+struct Cache {
+    std::array<Shard, kShards> mShards;
+
+    static std::size_t hash(std::string_view key) noexcept { return std::hash<std::string_view>()(key); }
+    Shard& shard(std::size_t hash) noexcept { return mShards[(hash >> 48) % kShards]; }
+};
+
+Cache cache;
+
+// 与 memcached 相同：不超过 30 天视为相对时间，否则为 Unix 时间戳；负数表示立即过期
+std::int64_t absoluteExpire(std::int64_t exptime, std::int64_t now) {
+    if (exptime < 0) {
+        return now;
+    }
+    if (exptime == 0 || exptime > 60 * 60 * 24 * 30) {
+        return exptime;
+    }
+    return now + exptime;
+}
+
+template <class T>
+bool parseNumber(std::string_view s, T& value) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+// 返回未读区开头一行的长度（不含 \r\n），这一行仍留在缓冲区中
+template <class Stream>
+co_async::Task<std::size_t> lineLength(Stream& stream) {
+    std::size_t scanned = 0;
+    while (true) {
+        auto buf = stream.peek();
+        if (buf.size() > scanned) {
+            if (auto* p = static_cast<char const*>(std::memchr(buf.data() + scanned, '\n', buf.size() - scanned))) {
+                std::size_t n = p - buf.data();
+                co_return n && buf[n - 1] == '\r' ? n - 1 : n;
+            }
+        }
+        scanned = buf.size();
+        co_await stream.ensure(buf.size() + 1);
+    }
+}
+
+template <class Stream>
+co_async::Task<> skipBytes(Stream& stream, std::size_t n) {
+    while (n) {
+        auto buf = stream.peek();
+        if (buf.empty()) {
+            buf = co_await stream.ensure(1);
+        }
+        std::size_t k = std::min(n, buf.size());
+        stream.consume(k);
+        n -= k;
+    }
+}
+
+// 开头一行连同换行符（\r\n 或 \n）的长度
+template <class Stream>
+std::size_t lineEnd(Stream& stream, std::size_t len) {
+    return stream.peek()[len] == '\r' ? len + 2 : len + 1;
+}
+
+template <class Stream>
+co_async::Task<> handleGet(Stream& stream, std::span<std::string_view const> keys) {
+    std::int64_t now = std::time(nullptr);
+    for (auto key : keys) {
+        std::size_t h = Cache::hash(key);
+        Shard& shard = cache.shard(h);
+        Item* item;
+        {
+            std::lock_guard lock(shard.mMutex);
+            item = shard.find(key, h, now);
+            if (!item) {
+                continue;
+            }
+            shard.acquire(item);
+        }
+        // 写出时不持有锁，引用计数保证期间该项不会被释放
+        co_await stream.print("VALUE "sv, key, ' ', item->mFlags, ' ', item->mBytes, "\r\n"sv);
+        co_await stream.puts(item->data_with_crlf());
+        std::lock_guard lock(shard.mMutex);
+        shard.release(item);
+    }
+    co_await stream.puts("END\r\n");
+}
+
+enum class StoreMode {
+    Set,
+    Add,
+    Replace,
+};
+
+// 命令行已被消耗，数据块仍在流中
+template <class Stream>
+co_async::Task<std::string_view> handleStore(Stream& stream, StoreMode mode, std::string_view key, std::uint32_t flags,
+                                             std::int64_t exptime, std::size_t bytes) {
+    std::size_t h = Cache::hash(key);
+    Shard& shard = cache.shard(h);
+    std::int64_t now = std::time(nullptr);
+    std::string large;
+    std::span<char const> data;
+    if (bytes + 2 <= stream.ensure_limit()) {
+        data = co_await stream.ensure(bytes + 2);
+    } else if (SlabAllocator::classFor(sizeof(Item) + key.size() + bytes + 2) >= 0) {
+        large = co_await stream.getn(bytes + 2);
+        data = large;
+    } else {
+        co_await skipBytes(stream, bytes + 2);
+        co_return "SERVER_ERROR object too large for cache\r\n"sv;
+    }
+    std::string_view reply;
+    if (data[bytes] != '\r' || data[bytes + 1] != '\n') {
+        reply = "CLIENT_ERROR bad data chunk\r\n"sv;
+    } else {
+        std::lock_guard lock(shard.mMutex);
+        bool exists = shard.find(key, h, now) != nullptr;
+        if ((mode == StoreMode::Add && exists) || (mode == StoreMode::Replace && !exists)) {
+            reply = "NOT_STORED\r\n"sv;
+        } else if (Item* item = shard.allocate(key, bytes)) {
+            item->mFlags = flags;
+            item->mExpire = absoluteExpire(exptime, now);
+            std::memcpy(item->data(), data.data(), bytes + 2);
+            shard.link(item, h);
+            reply = "STORED\r\n"sv;
+        } else {
+            reply = "SERVER_ERROR out of memory storing object\r\n"sv;
+        }
+    }
+    if (large.empty()) {
+        stream.consume(bytes + 2);
+    }
+    co_return reply;
+}
+
+std::string_view handleDelete(std::string_view key) {
+    std::size_t h = Cache::hash(key);
+    Shard& shard = cache.shard(h);
+    std::lock_guard lock(shard.mMutex);
+    if (Item* item = shard.find(key, h, std::time(nullptr))) {
+        shard.unlink(item);
+        return "DELETED\r\n"sv;
+    }
+    return "NOT_FOUND\r\n"sv;
+}
+
+// 一条连接：流水线中同一轮处理完的各条回复由自动 flush 合并为一次写出
+co_async::Task<> serveConnection(co_async::EpollLoop& loop, co_async::AsyncFile file, bool& done) {
+    co_async::FileStream stream(loop, std::move(file));
+    stream.set_auto_flush(loop);
+    stream.set_watermarks(64 * 1024, 1024 * 1024);
+    std::vector<std::string_view> tokens;
+    try {
+        while (true) {
+            std::size_t len = co_await lineLength(stream);
+            co_await stream.writable();
+            std::string_view line(stream.peek().data(), len);
+            std::size_t consumed = lineEnd(stream, len);
+            tokens.clear();
+            for (std::size_t i = 0; i < line.size();) {
+                std::size_t j = line.find(' ', i);
+                j = j == line.npos ? line.size() : j;
+                if (j != i) {
+                    tokens.push_back(line.substr(i, j - i));
+                }
+                i = j + 1;
+            }
+            if (tokens.empty() || tokens.size() > kMaxTokens) {
+                stream.consume(consumed);
+                co_await stream.puts("ERROR\r\n");
+                continue;
+            }
+            auto cmd = tokens[0];
+            if ((cmd == "get" || cmd == "gets") && tokens.size() >= 2) {
+                // 键直接指向输入缓冲区，处理完再消耗这一行
+                co_await handleGet(stream, std::span(tokens).subspan(1));
+                stream.consume(consumed);
+            } else if ((cmd == "set" || cmd == "add" || cmd == "replace") &&
+                       (tokens.size() == 5 || (tokens.size() == 6 && tokens[5] == "noreply"))) {
+                std::uint32_t flags;
+                std::int64_t exptime;
+                std::size_t bytes;
+                if (tokens[1].size() > kMaxKeySize || !parseNumber(tokens[2], flags) ||
+                    !parseNumber(tokens[3], exptime) || !parseNumber(tokens[4], bytes)) {
+                    stream.consume(consumed);
+                    co_await stream.puts("CLIENT_ERROR bad command line format\r\n");
+                    continue;
+                }
+                // 读取数据块可能挪动缓冲区，先把键复制出来
+                char key[kMaxKeySize];
+                std::size_t keyLen = tokens[1].size();
+                std::memcpy(key, tokens[1].data(), keyLen);
+                bool noreply = tokens.size() == 6;
+                auto mode = cmd == "set" ? StoreMode::Set : cmd == "add" ? StoreMode::Add : StoreMode::Replace;
+                stream.consume(consumed);
+                auto reply = co_await handleStore(stream, mode, std::string_view(key, keyLen), flags, exptime, bytes);
+                if (!noreply) {
+                    co_await stream.puts(reply);
+                }
+            } else if (cmd == "delete" && (tokens.size() == 2 || (tokens.size() == 3 && tokens[2] == "noreply"))) {
+                auto reply = handleDelete(tokens[1]);
+                bool noreply = tokens.size() == 3;
+                stream.consume(consumed);
+                if (!noreply) {
+                    co_await stream.puts(reply);
+                }
+            } else if (cmd == "flush_all") {
+                stream.consume(consumed);
+                for (auto& shard : cache.mShards) {
+                    std::lock_guard lock(shard.mMutex);
+                    shard.clear();
+                }
+                co_await stream.puts("OK\r\n");
+            } else if (cmd == "version") {
+                stream.consume(consumed);
+                co_await stream.puts("VERSION 1.6.0-co_async\r\n");
+            } else if (cmd == "quit") {
+                break;
+            } else {
+                stream.consume(consumed);
+                co_await stream.puts("ERROR\r\n");
+            }
+        }
+    } catch (co_async::EOFException const&) {
+    } catch (std::exception const&) {
+        // 连接出错或请求行超过缓冲区容量：关闭连接
+    }
+    try {
+        co_await stream.flush();
+    } catch (...) {
+    }
+    done = true;
+}
+
+struct Connection {
+    co_async::Task<> mTask;
+    bool mDone = false;
+};
+
+co_async::Task<> acceptLoop(co_async::EpollLoop& loop, co_async::AsyncFile& listener) {
+    std::list<Connection> connections;
+    while (true) {
+        auto [sock, addr] = co_await co_async::socket_accept<co_async::IpAddress>(loop, listener);
+        // 流水线的回复可能跨几轮写出，不能让 Nagle 算法等待对端的延迟确认
+        co_async::socketSetOption<int>(sock, IPPROTO_TCP, TCP_NODELAY, 1);
+        connections.remove_if([](Connection const& c) { return c.mDone; });
+        auto& c = connections.emplace_back();
+        c.mTask = serveConnection(loop, std::move(sock), c.mDone);
+        co_async::spawn_task(c.mTask);
+    }
+}
+
+// 每个线程：一个 loop、一个 SO_REUSEPORT 的监听套接字；stopFile 可读时退出
+void serverThread(int stopFd, std::atomic<std::size_t>& ready) {
+    co_async::AsyncLoop loop;
+    co_async::AsyncFile stopFile(dup(stopFd));
+    co_async::run_task(loop, [&]() -> co_async::Task<> {
+        auto listener = co_await co_async::create_tcp_server(
+            loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort), 0, true);
+        co_async::socket_listen(listener);
+        ++ready;
+        co_await co_async::when_any(acceptLoop(loop, listener), co_async::wait_file_event(loop, stopFile, EPOLLIN));
+    }());
+}
+
+// 压测客户端：每条连接一次发出 kDepth 条命令再依次读回复；
+// 80% 单键 get，10% 10 键 get，10% set，键空间 kKeys 个，值 kValueSize 字节
+constexpr std::size_t kClients = 16;
+constexpr std::size_t kDepth = 32;
+constexpr std::size_t kKeys = 100000;
+constexpr std::size_t kValueSize = 100;
+constexpr auto kDuration = 3s;
+
+struct BenchStats {
+    std::size_t mOps = 0;
+    std::size_t mKeys = 0;
+    std::size_t mHits = 0;
+};
+
+template <class Stream>
+co_async::Task<std::string_view> readLine(Stream& stream, std::string& line) {
+    std::size_t len = co_await lineLength(stream);
+    line.assign(stream.peek().data(), len);
+    stream.consume(lineEnd(stream, len));
+    co_return line;
+}
+
+// 读一条 get 的回复，返回命中的键数
+template <class Stream>
+co_async::Task<std::size_t> readValues(Stream& stream, std::string& line) {
+    std::size_t hits = 0;
+    while (co_await readLine(stream, line) != "END") {
+        std::size_t bytes = 0;
+        parseNumber(std::string_view(line).substr(line.rfind(' ') + 1), bytes);
+        co_await skipBytes(stream, bytes + 2);
+        ++hits;
+    }
+    co_return hits;
+}
+
+co_async::Task<BenchStats> benchClient(co_async::AsyncLoop& loop, unsigned seed, bool preload) {
+    auto sock = co_await co_async::create_tcp_client(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort));
+    co_async::socketSetOption<int>(sock, IPPROTO_TCP, TCP_NODELAY, 1);
+    co_async::FileStream stream(loop, std::move(sock));
+    std::string value(kValueSize, 'v');
+    std::string line;
+    BenchStats stats;
+    if (preload) {
+        for (std::size_t k = 0; k < kKeys; k += kDepth) {
+            std::size_t n = std::min(kDepth, kKeys - k);
+            for (std::size_t i = 0; i < n; ++i) {
+                co_await stream.print("set key:"sv, k + i, " 0 0 "sv, kValueSize, "\r\n"sv, value, "\r\n"sv);
+            }
+            co_await stream.flush();
+            for (std::size_t i = 0; i < n; ++i) {
+                co_await readLine(stream, line);
+            }
+        }
+        co_return stats;
+    }
+    std::minstd_rand rng(seed);
+    std::vector<int> kinds(kDepth);
+    auto deadline = std::chrono::steady_clock::now() + kDuration;
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (auto& kind : kinds) {
+            auto dice = rng() % 10;
+            kind = dice < 8 ? 0 : dice < 9 ? 1 : 2;
+            if (kind == 0) {
+                co_await stream.print("get key:"sv, rng() % kKeys, "\r\n"sv);
+            } else if (kind == 1) {
+                co_await stream.puts("get");
+                for (int i = 0; i < 10; ++i) {
+                    co_await stream.print(" key:"sv, rng() % kKeys);
+                }
+                co_await stream.puts("\r\n");
+            } else {
+                co_await stream.print("set key:"sv, rng() % kKeys, " 0 0 "sv, kValueSize, "\r\n"sv, value, "\r\n"sv);
+            }
+        }
+        co_await stream.flush();
+        for (auto kind : kinds) {
+            if (kind == 2) {
+                co_await readLine(stream, line);
+            } else {
+                stats.mHits += co_await readValues(stream, line);
+                stats.mKeys += kind == 0 ? 1 : 10;
+            }
+            ++stats.mOps;
+        }
+    }
+    co_return stats;
+}
+
+void runBenchmark() {
+    co_async::AsyncLoop loop;
+    co_async::run_task(loop, benchClient(loop, 0, true));
+    std::vector<co_async::Task<BenchStats>> clients;
+    for (std::size_t i = 0; i < kClients; ++i) {
+        clients.push_back(benchClient(loop, i + 1, false));
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    auto results = co_async::run_task(loop, co_async::when_all(clients));
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    BenchStats total;
+    for (auto const& r : results) {
+        total.mOps += r.mOps;
+        total.mKeys += r.mKeys;
+        total.mHits += r.mHits;
+    }
+    std::cout << kClients << " 条连接、流水线深度 " << kDepth << ": " << static_cast<std::size_t>(total.mOps / secs)
+              << " 命令/秒，" << static_cast<std::size_t>(total.mKeys / secs) << " 键/秒，命中率 "
+              << (total.mKeys ? 100 * total.mHits / total.mKeys : 0) << "%\n";
+}
+
+int main(int argc, char** argv) {
+    bool serveOnly = argc > 1 && argv[1] == "serve"sv;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    co_async::AsyncFile stopFile(co_async::checkError(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)));
+    std::atomic<std::size_t> ready{0};
+    std::vector<std::thread> servers;
+    for (std::size_t i = 0; i < threads; ++i) {
+        servers.emplace_back(serverThread, stopFile.fileNo(), std::ref(ready));
+    }
+    while (ready < threads) {
+        std::this_thread::sleep_for(1ms);
+    }
+    std::cout << threads << " 个线程监听 127.0.0.1:" << kPort << "\n";
+    if (serveOnly) {
+        for (auto& t : servers) {
+            t.join();
+        }
+        return 0;
+    }
+    runBenchmark();
+    std::uint64_t one = 1;
+    co_async::checkError(write(stopFile.fileNo(), &one, sizeof one));
+    for (auto& t : servers) {
+        t.join();
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/http.hpp"
+#include "co_async/http_client.hpp"
+#include "co_async/socket.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+#include "co_async/when_any.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <netinet/tcp.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HTTP/1.1 服务器：保持连接、流水线、chunked 请求与响应正文、生成器流式正文、空闲超时。
+// 不带参数运行时先演示各项功能，再用进程内的 HttpConnection 客户端压测回环地址上的每秒请求数；
+// 带 serve 参数时只作为服务器运行（可以用 wrk 等外部工具压测）
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+constexpr int kPort = 18080;
+constexpr std::size_t kConnections = 16;
+constexpr auto kDuration = 2s;
+
+co_async::Generator<std::string> countdown() {
+    for (int i = 3; i > 0; --i) {
+        co_yield std::to_string(i) + "...\n";
+        co_await co_async::sleep_for(loop, 10ms);
+    }
+    co_yield "liftoff\n"s;
+}
+
+co_async::HttpServer make_server() {
+    co_async::HttpServer server;
+    server.add_route("GET", "/", [](co_async::HttpRequest&) -> co_async::Task<co_async::HttpResponse> {
+        co_async::HttpResponse response;
+        response.mHeaders.emplace_back("content-type", "text/plain");
+        response.mBody = "Hello, World!\n";
+        co_return response;
+    });
+    server.add_route("POST", "/echo", [](co_async::HttpRequest& request) -> co_async::Task<co_async::HttpResponse> {
+        co_async::HttpResponse response;
+        response.mBody = co_await request.read_body();
+        co_return response;
+    });
+    server.add_route("GET", "/stream", [](co_async::HttpRequest&) -> co_async::Task<co_async::HttpResponse> {
+        co_async::HttpResponse response;
+        response.mBodyStream = countdown();
+        co_return response;
+    });
+    // 204 没有正文，响应中也不带 content-length，连接照常保持
+    server.add_route("DELETE", "/item", [](co_async::HttpRequest&) -> co_async::Task<co_async::HttpResponse> {
+        co_async::HttpResponse response;
+        response.mStatus = 204;
+        co_return response;
+    });
+    server.set_idle_timeout(5s);
+    return server;
+}
+
+struct Connection {
+    co_async::Task<> mTask;
+    bool mDone = false;
+};
+
+co_async::Task<> serveConnection(co_async::HttpServer& server, co_async::AsyncFile file, bool& done) {
+    co_async::FileStream stream(loop, std::move(file));
+    co_await server.serve(loop, loop, stream);
+    done = true;
+}
+
+co_async::Task<> server_main(co_async::AsyncFile& listener) {
+    auto server = make_server();
+    std::list<Connection> connections;
+    while (true) {
+        auto [sock, addr] = co_await co_async::socket_accept<co_async::IpAddress>(loop, listener);
+        co_async::socketSetOption<int>(sock, IPPROTO_TCP, TCP_NODELAY, 1);
+        connections.remove_if([](Connection const& c) { return c.mDone; });
+        auto& c = connections.emplace_back();
+        c.mTask = serveConnection(server, std::move(sock), c.mDone);
+        co_async::spawn_task(c.mTask);
+    }
+}
+
+co_async::Task<co_async::FileStream> connect() {
+    auto sock = co_await co_async::create_tcp_client(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort));
+    co_async::socketSetOption<int>(sock, IPPROTO_TCP, TCP_NODELAY, 1);
+    co_return co_async::FileStream(loop, std::move(sock));
+}
+
+// 读出一条响应的原始字节，用于展示服务器写出的内容（演示的路由只用 content-length 或 chunked）
+co_async::Task<std::string> read_response(co_async::FileStream& stream) {
+    co_async::HttpHeadScanner scanner;
+    std::size_t headLen;
+    while (!(headLen = scanner.feed(stream.peek()))) {
+        co_await stream.ensure(stream.peek().size() + 1);
+    }
+    std::string response(stream.peek().data(), headLen);
+    stream.consume(headLen);
+    co_async::HttpResponseHead head;
+    co_async::httpParseResponseHead(response, head);
+    co_async::HttpBodyDecoder<co_async::FileStream> body(stream);
+    co_async::httpSetupBody(body, head.mHeaders);
+    while (true) {
+        auto chunk = co_await body.read_some();
+        if (chunk.empty()) {
+            break;
+        }
+        response.append(chunk.data(), chunk.size());
+    }
+    co_return response;
+}
+
+co_async::Task<> demo() {
+    auto stream = co_await connect();
+    // 三条请求一次发出（流水线），其中第二条是 chunked 编码的 POST
+    co_await stream.puts("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                         "POST /echo HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+                         "6\r\nchunk \r\n7\r\ned body\r\n0\r\n\r\n"
+                         "GET /stream HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    co_await stream.flush();
+    for (int i = 0; i < 3; ++i) {
+        std::cout << "--- 响应 " << i + 1 << " ---\n" << co_await read_response(stream) << "\n";
+    }
+    // 204 之后的请求仍在同一条连接上得到回复
+    co_await stream.puts("DELETE /item HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                         "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    co_await stream.flush();
+    for (int i = 3; i < 5; ++i) {
+        std::cout << "--- 响应 " << i + 1 << " ---\n" << co_await read_response(stream) << "\n";
+    }
+    co_await stream.puts("GET /missing HTTP/1.1\r\nConnection: close\r\n\r\n");
+    co_await stream.flush();
+    std::cout << "--- 响应 6 ---\n" << co_await read_response(stream) << "\n";
+}
+
+// 压测客户端：每条连接上 depth 个协程并发请求，请求在 HttpConnection 上组成流水线
+co_async::Task<std::size_t> bench_caller(co_async::HttpConnection<co_async::FileStream>& http) {
+    std::size_t requests = 0;
+    auto deadline = std::chrono::steady_clock::now() + kDuration;
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto response = co_await http.get("/");
+        (void)co_await response.read_body();
+        ++requests;
+    }
+    co_return requests;
+}
+
+co_async::Task<std::size_t> bench_client(std::size_t depth) {
+    auto stream = co_await connect();
+    co_async::HttpConnection http(loop, stream, "localhost");
+    std::vector<co_async::Task<std::size_t>> callers;
+    for (std::size_t i = 0; i < depth; ++i) {
+        callers.push_back(bench_caller(http));
+    }
+    std::size_t total = 0;
+    for (auto n : co_await co_async::when_all(callers)) {
+        total += n;
+    }
+    co_return total;
+}
+
+co_async::Task<> bench(std::size_t depth) {
+    std::vector<co_async::Task<std::size_t>> clients;
+    for (std::size_t i = 0; i < kConnections; ++i) {
+        clients.push_back(bench_client(depth));
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    auto results = co_await co_async::when_all(clients);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::size_t total = 0;
+    for (auto n : results) {
+        total += n;
+    }
+    std::cout << kConnections << " 条连接，流水线深度 " << depth << ": " << static_cast<std::size_t>(total / secs)
+              << " 请求/秒\n";
+}
+
+co_async::Task<> client_main() {
+    co_await demo();
+    co_await bench(1);
+    co_await bench(16);
+}
+
+co_async::Task<> amain(bool serveOnly) {
+    auto listener = co_await co_async::create_tcp_server(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort));
+    co_async::socket_listen(listener);
+    if (serveOnly) {
+        std::cout << "监听 127.0.0.1:" << kPort << "\n";
+        co_await server_main(listener);
+    }
+    // 客户端结束后不再等待服务器
+    co_await co_async::when_any(server_main(listener), client_main());
+}
+
+int main(int argc, char** argv) {
+    run_task(loop, amain(argc > 1 && argv[1] == "serve"sv));
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/socket.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+
+#include <iostream>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+// TCP Fast Open：connect_with_data 把首段请求随 SYN 发出。
+// 第一次连接还没有 cookie，内核只发 SYN 索取 cookie（EINPROGRESS），请求在握手完成后照常写出；
+// 之后的连接带上 cookie，请求直接搭在 SYN 上。Unix 域套接字不支持 TFO（EOPNOTSUPP），退化为普通 connect。
+// 捎带要生效需 net.ipv4.tcp_fastopen 同时开启客户端和服务端（值为 3），否则每次都走 EINPROGRESS 的路径
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+constexpr int kPort = 23460;
+constexpr int kConnections = 3;
+constexpr const char* kUnixPath = "step19.sock";
+
+// 回显一行，等客户端先关闭：TIME_WAIT 留在客户端一侧，监听端口可以立即再次绑定
+co_async::Task<> echo_once(co_async::AsyncFile sock) {
+    co_async::FileStream stream(loop, std::move(sock));
+    auto line = co_await stream.getline('\n');
+    co_await stream.puts(line);
+    co_await stream.putchar('\n');
+    co_await stream.flush();
+    try {
+        (void)co_await stream.getchar();
+    } catch (co_async::EOFException const&) {
+    }
+}
+
+co_async::Task<> tcp_server(co_async::AsyncFile& listener) {
+    for (int i = 0; i < kConnections; ++i) {
+        auto [sock, addr] = co_await co_async::socket_accept<co_async::IpAddress>(loop, listener);
+        co_await echo_once(std::move(sock));
+    }
+}
+
+// socket_accept 只认 IP 地址，Unix 域套接字直接 accept4
+co_async::Task<> unix_server(co_async::AsyncFile& listener) {
+    co_await co_async::wait_file_event(loop, listener, EPOLLIN);
+    int fd = co_async::checkError(accept4(listener.fileNo(), nullptr, nullptr, SOCK_NONBLOCK));
+    co_await echo_once(co_async::AsyncFile(fd));
+}
+
+co_async::Task<> tcp_client() {
+    auto addr = co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort);
+    for (int i = 0; i < kConnections; ++i) {
+        auto sock = co_await co_async::connect_with_data(loop, addr, "hello over SYN\n"sv);
+        co_async::FileStream stream(loop, std::move(sock));
+        auto reply = co_await stream.getline('\n');
+        // 收到回显时握手早已完成，此时 tcp_info 能说明 SYN 上的数据是否被服务端接受
+        auto info = co_async::socketGetOption<tcp_info>(stream.mFile, IPPROTO_TCP, TCP_INFO);
+        bool synData = info.tcpi_options & TCPI_OPT_SYN_DATA;
+        std::cout << "第 " << i + 1 << " 次连接: " << (synData ? "请求随 SYN 发出" : "请求在握手后发出")
+                  << "，回显 " << reply << "\n";
+    }
+}
+
+co_async::Task<> unix_client() {
+    auto sock = co_await co_async::connect_with_data(loop, co_async::SocketAddress(kUnixPath), "hello over unix\n"sv);
+    co_async::FileStream stream(loop, std::move(sock));
+    std::cout << "Unix 域套接字: 回显 " << co_await stream.getline('\n') << "\n";
+}
+
+co_async::Task<> amain() {
+    auto listener = co_await co_async::create_tcp_server(
+        loop, co_async::socket_address(co_async::ip_address("127.0.0.1"), kPort), 16);
+    co_async::socket_listen(listener);
+    co_await co_async::when_all(tcp_server(listener), tcp_client());
+
+    unlink(kUnixPath);
+    auto unixListener = co_await co_async::create_tcp_server(loop, co_async::SocketAddress(kUnixPath));
+    co_async::socket_listen(unixListener);
+    co_await co_async::when_all(unix_server(unixListener), unix_client());
+    unlink(kUnixPath);
+}
+
+int main() {
+    run_task(loop, amain());
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+// 流上的数值读写：read_int/read_double 跳过空白后直接在缓冲区上 from_chars，
+// 数字被拆在两次读取之间时等数据到齐再解析；print/format 直接写进输出缓冲区
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+co_async::Task<> parse_string() {
+    co_async::StringIStream in(co_async::StringReadBuf("  42\t-17\nff 3.25 -1e3 inf 12ms 99999999999999999999 abc"));
+    int a = co_await in.read_int<int>();
+    int b = co_await in.read_int<int>();
+    int c = co_await in.read_int<int>(16);
+    std::cout << "整数: " << a << " " << b << " " << c << "\n";
+    double x = co_await in.read_double();
+    double y = co_await in.read_double();
+    double z = co_await in.read_double();
+    std::cout << "浮点: " << x << " " << y << " " << z << "\n";
+    // 单位后缀不属于数字，读完数字后留在流中
+    int ms = co_await in.read_int<int>();
+    std::cout << "带单位: " << ms << " 后面是 " << co_await in.getn(2) << "\n";
+    try {
+        (void)co_await in.read_int<int>();
+    } catch (std::out_of_range const& e) {
+        std::cout << "超出范围: " << e.what() << "\n";
+    }
+    try {
+        (void)co_await in.read_int<int>();
+    } catch (std::invalid_argument const& e) {
+        std::cout << "不是数字: " << e.what() << "\n";
+    }
+}
+
+// 写端把数字拆成几段分别送出，读端在数字结束前不会开始解析
+co_async::Task<> send_fragments(co_async::PipeStream& out) {
+    for (auto part : {"31"sv, "41"sv, "5 2.7"sv, "18\n"sv}) {
+        co_await out.puts(part);
+        co_await out.flush();
+    }
+}
+
+co_async::Task<> read_fragments(co_async::PipeStream& in) {
+    auto n = co_await in.read_int<long>();
+    auto d = co_await in.read_double();
+    std::cout << "跨读取: " << n << " " << d << "\n";
+}
+
+co_async::Task<> write_numbers() {
+    co_async::StringOStream out;
+    co_await out.print("print: ", 42, " ", -2.5, " ", true, ' ', "end\n");
+    co_await out.format("format: {} + {} = {} {{原样}}\n", 1, 2, 3);
+    co_await out.flush();
+    std::cout << out.mString;
+}
+
+co_async::Task<> amain() {
+    co_await parse_string();
+    auto [a, b] = co_async::make_pipe(loop);
+    co_async::PipeStream writer(std::move(a)), reader(std::move(b));
+    co_await co_async::when_all(send_fragments(writer), read_fragments(reader));
+    co_await write_numbers();
+}
+
+int main() {
+    run_task(loop, amain());
+    return 0;
+}
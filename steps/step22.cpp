@@ -0,0 +1,66 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/connect_any.hpp"
+#include "co_async/socket.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Happy Eyeballs 的错开时间：一个尝试既未成功也未失败时，下一个在 delay 之后才发起；
+// 一个尝试失败（如 ECONNREFUSED）时，下一个立即发起，不必等满 delay
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+constexpr int kOpenPort = 23464;    // 正常监听
+constexpr int kClosedPort = 23465;  // 无人监听，连接被拒绝
+constexpr int kStalledPort = 23466; // 全连接队列已满，SYN 被丢弃，连接迟迟不建立
+constexpr auto kDelay = 200ms;
+
+co_async::SocketAddress local(int port) {
+    return co_async::socket_address(co_async::ip_address("127.0.0.1"), port);
+}
+
+co_async::Task<> try_connect(const char* name, std::vector<co_async::SocketAddress> addrs) {
+    auto t0 = std::chrono::steady_clock::now();
+    auto sock = co_await co_async::connect_any(loop, std::move(addrs), kDelay);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0);
+    sockaddr_in peer{};
+    socklen_t len = sizeof(peer);
+    co_async::checkError(getpeername(sock.fileNo(), (sockaddr*)&peer, &len));
+    std::cout << name << ": " << ms.count() << "ms 后连上端口 " << ntohs(peer.sin_port) << "\n";
+}
+
+co_async::Task<> amain() {
+    auto listener = co_await co_async::create_tcp_server(loop, local(kOpenPort));
+    co_async::socket_listen(listener);
+
+    // backlog 为 0 的监听套接字只能排队一个连接，占满后新的 SYN 被丢弃，对端一直重传
+    auto stalled = co_await co_async::create_tcp_server(loop, local(kStalledPort));
+    co_async::socket_listen(stalled, 0);
+    std::vector<co_async::AsyncFile> fillers;
+    for (int i = 0; i < 2; ++i) {
+        fillers.push_back(co_async::AsyncFile(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)));
+        auto addr = local(kStalledPort);
+        (void)connect(fillers.back().fileNo(), (const sockaddr*)&addr.mAddr, addr.mAddrLen);
+    }
+
+    std::vector<co_async::SocketAddress> refused{local(kClosedPort), local(kClosedPort), local(kOpenPort)};
+    co_await try_connect("拒绝, 拒绝, 正常", std::move(refused));
+    std::vector<co_async::SocketAddress> stalledFirst{local(kStalledPort), local(kOpenPort)};
+    co_await try_connect("无响应, 正常", std::move(stalledFirst));
+    std::vector<co_async::SocketAddress> mixed{local(kStalledPort), local(kClosedPort), local(kOpenPort)};
+    co_await try_connect("无响应, 拒绝, 正常", std::move(mixed));
+    std::vector<co_async::SocketAddress> allRefused{local(kClosedPort), local(kClosedPort)};
+    try {
+        co_await try_connect("拒绝, 拒绝", std::move(allRefused));
+    } catch (std::system_error const& e) {
+        std::cout << "全部失败: " << e.code().message() << "\n";
+    }
+}
+
+int main() {
+    run_task(loop, amain());
+    return 0;
+}
@@ -0,0 +1,810 @@
+#include "co_async/async_loop.hpp"
+#include "co_async/buffer_chain.hpp"
+#include "co_async/direct_file.hpp"
+#include "co_async/framing.hpp"
+#include "co_async/inline_buffer.hpp"
+#include "co_async/mirrored_buffer.hpp"
+#include "co_async/stream.hpp"
+#include "co_async/when_all.hpp"
+#include "co_async/when_any.hpp"
+
+#include <cstdint>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+// 事件循环、流层各种存储与编解码的行为检查：每项打印“通过/失败”，有失败时退出码非零
+
+using namespace std::literals;
+
+co_async::AsyncLoop loop;
+
+int failures = 0;
+bool finished = false; // 事件循环在协程卡住时也会返回，以此区分正常跑完
+
+void check(bool ok, std::string_view what) {
+    std::cout << (ok ? "通过: " : "失败: ") << what << "\n";
+    failures += !ok;
+}
+
+// ---- 同一 fd 上排队的等待者 ----
+
+co_async::Task<> fd_byte_reader(co_async::AsyncFile& file, std::string& got) {
+    co_await co_async::wait_file_event(loop, file, EPOLLIN);
+    char c;
+    if (read(file.fileNo(), &c, 1) == 1) {
+        got += c;
+    }
+}
+
+co_async::Task<> fd_cancelled_reader(co_async::AsyncFile& file, std::string& got) {
+    (void)co_await co_async::when_any(fd_byte_reader(file, got), co_async::sleep_for(loop, 10ms));
+}
+
+co_async::Task<> fd_late_writer(co_async::AsyncFile& file) {
+    co_await co_async::sleep_for(loop, 30ms);
+    (void)!write(file.fileNo(), "ab", 2);
+}
+
+co_async::Task<> check_shared_fd() {
+    int fds[2];
+    co_async::checkError(pipe2(fds, O_NONBLOCK));
+    co_async::AsyncFile in(fds[0]), out(fds[1]);
+    // 三个协程等同一 fd 可读，中间一个超时离开队列；两个字节依次分给剩下的两个
+    std::string got;
+    co_await co_async::when_all(fd_byte_reader(in, got), fd_cancelled_reader(in, got), fd_byte_reader(in, got),
+                                fd_late_writer(out));
+    check(got == "ab", "同一方向的多个等待者排队，每次就绪恢复一个，取消的等待者离开队列");
+}
+
+// ---- BufferPool ----
+
+void check_pool() {
+    co_async::BufferPool pool;
+    std::vector<char*> buffers;
+    for (int i = 0; i < 256; ++i) {
+        buffers.push_back(pool.acquire(4096));
+        buffers.back()[4095] = static_cast<char>(i);
+    }
+    std::size_t peak = pool.slab_count();
+    bool intact = true;
+    for (int i = 0; i < 256; ++i) {
+        intact &= buffers[i][4095] == static_cast<char>(i);
+        pool.release(buffers[i], 4096);
+    }
+    check(intact && peak == 4 && pool.slab_count() == co_async::BufferPool::kSpareSlabs,
+          "BufferPool 归还后把空闲 slab 还给系统，只留备用的一块");
+    char* again = pool.acquire(3000);
+    char* other = pool.acquire(70000);
+    check(pool.slab_count() == co_async::BufferPool::kSpareSlabs, "BufferPool 优先复用备用 slab，超大请求不占 slab");
+    pool.release(other, 70000);
+    pool.release(again, 3000);
+}
+
+// ---- MirroredBuffer ----
+
+// 当前进程中映射了多少段 memfd 环形缓冲区（每个 MirroredBuffer 占前后两段）
+std::size_t count_ring_mappings() {
+    std::ifstream maps("/proc/self/maps");
+    std::size_t n = 0;
+    for (std::string line; std::getline(maps, line);) {
+        n += line.find("co_async_ring") != line.npos;
+    }
+    return n;
+}
+
+std::string mirrored_line(int i) {
+    return "line " + std::to_string(i) + " " + std::string(i * 37 % 3000, 'a' + i % 26);
+}
+
+constexpr int kMirroredLines = 200;
+constexpr std::size_t kMirroredBlock = 60000;
+
+co_async::Task<> mirrored_writer(co_async::PipeStream& out) {
+    for (int i = 0; i < kMirroredLines; ++i) {
+        co_await out.puts(mirrored_line(i));
+        co_await out.putchar('\n');
+    }
+    std::string block(kMirroredBlock, '\0');
+    for (std::size_t i = 0; i < block.size(); ++i) {
+        block[i] = static_cast<char>(i * 7);
+    }
+    co_await out.puts(block);
+    co_await out.flush();
+    auto reply = co_await out.getline('\n');
+    check(reply == "done", "镜像流的输出侧正常写出");
+}
+
+co_async::Task<> mirrored_reader(co_async::IOStream<co_async::PipeBuf, co_async::MirroredBuffer>& in) {
+    bool linesOk = true;
+    for (int i = 0; i < kMirroredLines; ++i) {
+        linesOk &= co_await in.getline('\n') == mirrored_line(i);
+    }
+    check(linesOk, "跨越环形缓冲区首尾的 getline 内容正确");
+    // 未读数据总是连续的：接近容量的 ensure 也直接返回一段连续内存
+    auto block = co_await in.ensure(kMirroredBlock);
+    bool blockOk = block.size() >= kMirroredBlock;
+    for (std::size_t i = 0; blockOk && i < kMirroredBlock; ++i) {
+        blockOk = block[i] == static_cast<char>(i * 7);
+    }
+    check(blockOk, "ensure(60000) 在 64 KiB 环上得到连续且正确的数据");
+    in.consume(kMirroredBlock);
+    co_await in.puts("done\n");
+    co_await in.flush();
+    check(count_ring_mappings() == 2, "IOStream 只为输入侧建立一个双重映射，输出侧使用池化缓冲区");
+}
+
+// 多字节行尾的前缀出现在行内、行尾被拆在两次读取之间时都要正确切分
+co_async::Task<> eol_writer(co_async::PipeStream& out) {
+    for (auto part : {"ab\r\r"sv, "\ncd\r"sv, "\nrest"sv}) {
+        co_await out.puts(part);
+        co_await out.flush();
+    }
+}
+
+co_async::Task<> eol_reader(co_async::PipeStream& in) {
+    auto first = co_await in.getline("\r\n"sv);
+    auto second = co_await in.getline("\r\n"sv);
+    auto rest = co_await in.getn(4);
+    check(first == "ab\r" && second == "cd" && rest == "rest", "getline 按多字节行尾切分，跨读取的行尾也能识别");
+}
+
+co_async::Task<> check_mirrored() {
+    {
+        co_async::MirroredBuffer ring(4096);
+        ring.acquire(co_async::BufferPool::local());
+        ring[10] = 'x';
+        ring.data()[ring.size() + 20] = 'y';
+        check(ring.data()[ring.size() + 10] == 'x' && ring[20] == 'y', "MirroredBuffer 前后两半映射同一块内存");
+    }
+    check(count_ring_mappings() == 0, "MirroredBuffer 析构后解除映射");
+    auto [a, b] = co_async::make_pipe(loop);
+    co_async::PipeStream writer(std::move(a));
+    co_async::IOStream<co_async::PipeBuf, co_async::MirroredBuffer> reader(std::move(b));
+    co_await co_async::when_all(mirrored_writer(writer), mirrored_reader(reader));
+    auto [c, d] = co_async::make_pipe(loop);
+    co_async::PipeStream eolWriter(std::move(c)), eolReader(std::move(d));
+    co_await co_async::when_all(eol_writer(eolWriter), eol_reader(eolReader));
+}
+
+// ---- BufferChain / ChainBuf ----
+
+std::string pattern(std::size_t n) {
+    std::string s(n, '\0');
+    for (std::size_t i = 0; i < n; ++i) {
+        s[i] = static_cast<char>('A' + i % 53);
+    }
+    return s;
+}
+
+constexpr std::size_t kChainBytes = 200000; // 超过管道容量，writev 必然分多次写完
+
+co_async::Task<> chain_writer(co_async::AsyncFile& file, co_async::BufferChain& chain) {
+    auto n = co_await co_async::writev_file(loop, file, chain);
+    check(n == kChainBytes && chain.empty(), "writev_file 分多次写出整条链并移除已写部分");
+    file = co_async::AsyncFile();
+}
+
+co_async::Task<> chain_reader(co_async::AsyncFile& file, std::string const& expect) {
+    co_async::BufferChain received;
+    while (co_await co_async::read_file(loop, file, received) != 0) {
+    }
+    check(received.to_string() == expect, "read_file 追加到链尾，收到的数据与发送的一致");
+}
+
+co_async::Task<> check_chain() {
+    auto data = pattern(10000);
+    co_async::BufferChain chain;
+    chain.append(std::span<char const>(data.data(), 3000));
+    chain.append(std::span<char const>(data.data() + 3000, data.size() - 3000));
+    check(chain.size() == data.size() && chain.slices().size() == 2 &&
+              chain.slices().front().size() == co_async::BufferChain::kBlockSize && chain.to_string() == data,
+          "append 先填满末尾切片的剩余空间再分配新块");
+
+    // 拆分和复制只共享内存块，不复制数据
+    auto copy = chain;
+    check(copy.slices().front().data() == chain.slices().front().data(), "复制的链与原链共享切片");
+    auto head = chain.split(5000);
+    check(head.to_string() == data.substr(0, 5000) && chain.to_string() == data.substr(5000),
+          "split 在切片中间拆开，两边内容正确");
+    check(head.slices().back().data() + head.slices().back().size() == chain.slices().front().data(),
+          "被拆开的切片两半仍指向同一内存块");
+    // 共享的块没有可追加的剩余空间：往 head 追加不能覆盖 chain 开头的数据
+    head.append(std::span<char const>("xyz", 3));
+    check(chain.to_string() == data.substr(5000) && head.to_string() == data.substr(0, 5000) + "xyz",
+          "往共享内存块的切片后追加时另起新块");
+
+    chain.consume(100);
+    iovec iov[8];
+    std::size_t n = chain.iovecs(iov);
+    std::size_t iovBytes = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        iovBytes += iov[i].iov_len;
+    }
+    check(n == chain.slices().size() && iovBytes == chain.size() && iov[0].iov_base == chain.slices().front().data(),
+          "iovecs 按切片导出链上的全部数据");
+    auto flat = chain.coalesce();
+    check(chain.slices().size() == 1 && std::string_view(flat.data(), flat.size()) == std::string_view(data).substr(5100),
+          "coalesce 合并为单个连续切片");
+    check(copy.to_string() == data, "原链的副本不受拆分、消费、合并影响");
+
+    // 经过管道的往返：writev 写出整条链，读端逐次追加到另一条链
+    auto big = pattern(kChainBytes);
+    co_async::BufferChain outgoing;
+    for (std::size_t off = 0; off < big.size(); off += 7000) {
+        auto part = co_async::BufferSlice::allocate(7000);
+        std::size_t len = std::min<std::size_t>(7000, big.size() - off);
+        std::memcpy(part.mBlock.get(), big.data() + off, len);
+        part.mSize = len;
+        outgoing.append(std::move(part));
+    }
+    int fds[2];
+    co_async::checkError(pipe2(fds, O_NONBLOCK));
+    co_async::AsyncFile readEnd(fds[0]), writeEnd(fds[1]);
+    co_await co_async::when_all(chain_writer(writeEnd, outgoing), chain_reader(readEnd, big));
+
+    // ChainBuf：输出流把数据追加到链上，原样交给输入流逐行读回
+    co_async::ChainOStream out;
+    for (int i = 0; i < 1000; ++i) {
+        co_await out.puts(mirrored_line(i));
+        co_await out.putchar('\n');
+    }
+    co_await out.flush();
+    co_async::ChainIStream in(co_async::ChainBuf(std::move(out.mChain)));
+    bool linesOk = true;
+    for (int i = 0; i < 1000; ++i) {
+        linesOk &= co_await in.getline('\n') == mirrored_line(i);
+    }
+    bool eof = false;
+    try {
+        (void)co_await in.getchar();
+    } catch (co_async::EOFException const&) {
+        eof = true;
+    }
+    check(linesOk && eof, "ChainOStream 写入的内容经 ChainIStream 逐行读回，链读空后为 EOF");
+}
+
+// ---- InlineBuffer ----
+
+template <std::size_t N>
+using InlineIStream = co_async::IStream<co_async::StringReadBuf, co_async::InlineBuffer<N>>;
+
+co_async::Task<> check_inline() {
+    check(sizeof(InlineIStream<256>) >= 256, "InlineBuffer 的存储内嵌在流对象中");
+
+    // 16 字节的缓冲区远小于行长，每行都要多次补充。
+    // StringReadBuf 总是同步完成，-O0 下每次补充都占栈帧，因此总数据量保持在几 KiB
+    auto shortLine = [](int i) { return "line " + std::to_string(i) + " " + std::string(i * 7 % 100, 'a' + i % 26); };
+    std::string text;
+    for (int i = 0; i < 50; ++i) {
+        text += shortLine(i) + "\n";
+    }
+    InlineIStream<16> lines(text);
+    bool linesOk = true;
+    for (int i = 0; i < 50; ++i) {
+        linesOk &= co_await lines.getline('\n') == shortLine(i);
+    }
+    check(linesOk, "16 字节 InlineBuffer 上 getline 读出长行");
+
+    // 数字跨越缓冲区边界时先把残余数据挪到开头再补充
+    InlineIStream<16> numbers("             123456789 -42 1e300"sv);
+    auto a = co_await numbers.read_int<long>();
+    auto b = co_await numbers.read_int<int>();
+    auto c = co_await numbers.read_double();
+    check(a == 123456789 && b == -42 && c == 1e300, "跨越缓冲区边界的数字完整解析");
+
+    InlineIStream<16> bounded("0123456789abcdefghij"sv);
+    auto head = co_await bounded.ensure(16);
+    bool limitOk = bounded.ensure_limit() == 16 && head.size() == 16;
+    try {
+        (void)co_await bounded.ensure(17);
+        limitOk = false;
+    } catch (std::length_error const&) {
+    }
+    check(limitOk, "ensure 以编译期容量为上限，超出时抛出 length_error");
+
+    // 移动流时未读数据随内嵌存储一起复制过去
+    bounded.consume(10);
+    auto moved = std::move(bounded);
+    check(co_await moved.getn(10) == "abcdefghij", "移动后的流继续读出剩余数据");
+
+    co_async::OStream<co_async::StringWriteBuf, co_async::InlineBuffer<8>> out;
+    auto expect = pattern(100);
+    co_await out.puts(expect);
+    for (int i = 0; i < 20; ++i) {
+        co_await out.putchar(static_cast<char>('a' + i));
+        expect.push_back(static_cast<char>('a' + i));
+    }
+    co_await out.flush();
+    check(out.mString == expect, "8 字节 InlineBuffer 输出流写出长字符串和逐字节写入");
+}
+
+// ---- 数值读取与 format ----
+
+co_async::Task<> check_numbers() {
+    // 不是数字的词整个被跳过（跨越缓冲区边界也一样），重试从下一个词继续
+    InlineIStream<16> words("  12 not-a-number-spanning-reads 34 x 56"sv);
+    int first = co_await words.read_int<int>();
+    std::string message;
+    int second = 0;
+    int retries = 0;
+    while (retries < 3) {
+        try {
+            second = co_await words.read_int<int>();
+            break;
+        } catch (std::invalid_argument const& e) {
+            message = e.what();
+            ++retries;
+        }
+    }
+    bool skipped = false;
+    try {
+        (void)co_await words.read_int<int>();
+    } catch (std::invalid_argument const&) {
+        skipped = true;
+    }
+    int third = co_await words.read_int<int>();
+    check(first == 12 && second == 34 && retries == 1 && skipped && third == 56 &&
+              message.ends_with("\"not-a-number-spanning-reads\""),
+          "read_int 跳过不是数字的词并在异常消息中给出该词，重试能继续读下去");
+
+#if defined(__cpp_lib_format)
+    co_async::OStream<co_async::StringWriteBuf, co_async::InlineBuffer<16>> small;
+    co_await small.format("{}-{}", 123, 456);
+    co_await small.format("{:>12}", 7);           // 剩余空间不够：flush 后重试
+    co_await small.format("{:*^20}", "wide"sv);   // 超过缓冲区容量：整体写出
+    co_await small.flush();
+    check(small.mString == "123-456" + std::string(11, ' ') + "7********wide********",
+          "format 放不下时 flush 后重试，超过缓冲区容量时整体写出");
+
+    co_async::StringOStream chained;
+    chained.set_watermarks(0, 1 << 20);
+    co_await chained.puts(std::string(co_async::BufferChain::kBlockSize - 6, '.'));
+    co_await chained.format("{:>10}", 42);        // 链尾只剩 6 字节
+    co_await chained.flush();
+    check(chained.mString == std::string(co_async::BufferChain::kBlockSize - 6, '.') + "        42",
+          "无界模式下链尾空间不足时另备连续空间再格式化");
+#endif
+}
+
+// ---- 自适应缓冲区 / readDirect ----
+
+// 缓冲区读空时读一个字节触发一次补充，返回这次读到的字节数，并丢弃读到的全部数据
+co_async::Task<std::size_t> fill_once(co_async::PipeStream& in) {
+    (void)co_await in.getchar();
+    std::size_t n = in.peek().size() + 1;
+    in.consume(n - 1);
+    co_return n;
+}
+
+co_async::Task<> direct_writer(co_async::PipeStream& out, std::string const& data) {
+    co_await out.puts(data);
+    co_await out.flush();
+}
+
+co_async::Task<> direct_reader(co_async::PipeStream& in, std::string const& data) {
+    auto head = co_await in.getn(10);
+    // 缓冲区里还留着第一次补充读到的数据，其余部分不小于缓冲区容量，直接读进目标字符串
+    auto body = co_await in.getn(data.size() - 10);
+    check(head + body == data, "getn 先取走缓冲区中的数据，其余直接读入目标字符串");
+}
+
+co_async::Task<> check_adaptive() {
+    auto [a, b] = co_async::make_pipe(loop);
+    co_async::PipeStream out(std::move(a)), in(std::move(b));
+    in.set_adaptive(32768);
+
+    // 每次都读满缓冲区：容量逐次翻倍，到上限为止（管道有 64 KiB 缓冲，先写后读不会阻塞）
+    co_await out.puts(pattern(8192 + 16384 + 32768 + 5000));
+    co_await out.flush();
+    std::size_t f1 = co_await fill_once(in);
+    std::size_t f2 = co_await fill_once(in);
+    std::size_t f3 = co_await fill_once(in);
+    std::size_t f4 = co_await fill_once(in);
+    check(f1 == 8192 && f2 == 16384 && f3 == 32768 && f4 == 5000, "读满缓冲区时容量翻倍，不超过上限");
+
+    // 读到的数据不足四分之一：容量逐次减半，不低于开启时的容量
+    co_await out.puts(pattern(100));
+    co_await out.flush();
+    (void)co_await fill_once(in); // 在 32 KiB 缓冲区上读到 100 字节，下次用 16 KiB
+    co_await out.puts(pattern(100));
+    co_await out.flush();
+    (void)co_await fill_once(in); // 在 16 KiB 缓冲区上读到 100 字节，下次用 8 KiB
+    co_await out.puts(pattern(100));
+    co_await out.flush();
+    (void)co_await fill_once(in);
+    co_await out.puts(pattern(8192));
+    co_await out.flush();
+    std::size_t shrunk = co_await fill_once(in);
+    check(shrunk == 8192, "读到的数据少时容量减半，回到开启时的容量");
+
+    // ensure 超过当前容量时直接扩容，已读入的数据保留在开头；超过上限时抛出 length_error
+    auto expect = pattern(40000);
+    co_await out.puts(expect);
+    co_await out.flush();
+    (void)co_await in.getchar();
+    auto frame = co_await in.ensure(20000);
+    bool grown = std::string_view(frame.data(), 20000) == std::string_view(expect).substr(1, 20000);
+    try {
+        (void)co_await in.ensure(40000);
+        grown = false;
+    } catch (std::length_error const&) {
+    }
+    check(grown, "ensure 遇到大帧时扩容并保留未读数据，超过上限时报错");
+
+    auto [c, d] = co_async::make_pipe(loop);
+    co_async::PipeStream directOut(std::move(c)), directIn(std::move(d));
+    auto data = pattern(300000);
+    co_await co_async::when_all(direct_writer(directOut, data), direct_reader(directIn, data));
+
+    // 直接读取中途遇到 EOF：抛出 EOFException
+    auto [e, f] = co_async::make_pipe(loop);
+    co_async::PipeStream shortOut(std::move(e)), shortIn(std::move(f));
+    co_await shortOut.puts(pattern(20000));
+    co_await shortOut.flush();
+    shortOut.close();
+    bool eof = false;
+    try {
+        (void)co_await shortIn.getn(50000);
+    } catch (co_async::EOFException const&) {
+        eof = true;
+    }
+    check(eof, "直接读取中途遇到 EOF 时抛出 EOFException");
+}
+
+// ---- DirectFileBuf ----
+
+// O_DIRECT 需要真实的块设备文件系统（tmpfs 不支持），文件放在当前目录
+constexpr const char* kDirectPath = "step23.direct";
+
+off_t file_size(const char* path) {
+    struct stat st {};
+    co_async::checkError(stat(path, &st));
+    return st.st_size;
+}
+
+std::string read_whole(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+co_async::Task<> check_direct(co_async::OffloadPool& pool) {
+    auto expect = pattern(3 * 65536 + 5000);
+    {
+        co_async::DirectFileOStream out(
+            co_await co_async::open_direct_file(pool, kDirectPath, O_WRONLY | O_CREAT | O_TRUNC));
+        // 先写出不足一块的尾部：补零写成整块后截断到实际长度
+        co_await out.puts(std::string_view(expect).substr(0, 5000));
+        co_await out.flush();
+        check(file_size(kDirectPath) == 5000 && read_whole(kDirectPath) == expect.substr(0, 5000),
+              "O_DIRECT 写出不足一块的尾部后文件截断到实际长度");
+        // 再次写入时先补齐上次的尾块，之后的整块、不对齐的片段和新的尾部都要落在正确位置
+        std::size_t off = 5000;
+        for (std::size_t len : {3000, 70000, 1, 65536, 57071}) {
+            co_await out.puts(std::string_view(expect).substr(off, len));
+            off += len;
+        }
+        co_await out.puts(std::string_view(expect).substr(off));
+        co_await out.flush();
+    }
+    check(file_size(kDirectPath) == static_cast<off_t>(expect.size()) && read_whole(kDirectPath) == expect,
+          "补齐尾块后继续写入，文件内容和长度正确");
+
+    {
+        co_async::DirectFileIStream in(co_await co_async::open_direct_file(pool, kDirectPath));
+        auto head = co_await in.getn(100);
+        // 缓冲区已满时 ensure 把未读数据搬到开头，再往不对齐的位置补充：这次经由中转缓冲区
+        auto window = co_await in.ensure(65500);
+        bool windowOk = head == expect.substr(0, 100) &&
+                        std::string_view(window.data(), 65500) == std::string_view(expect).substr(100, 65500);
+        in.consume(65500);
+        // 剩余部分远超缓冲区容量，getn 读进不对齐的字符串，最后不足一块的尾部视为文件末尾
+        auto rest = co_await in.getn(expect.size() - 65600);
+        bool eof = false;
+        try {
+            (void)co_await in.getchar();
+        } catch (co_async::EOFException const&) {
+            eof = true;
+        }
+        check(windowOk && rest == expect.substr(65600) && eof, "O_DIRECT 读取经由中转缓冲区补充不对齐的部分，读到尾部即 EOF");
+    }
+
+    {
+        // 从对齐的偏移开始读
+        co_async::DirectFileIStream in(co_await co_async::open_direct_file(pool, kDirectPath), off_t(8192));
+        check(co_await in.getn(1000) == expect.substr(8192, 1000), "从对齐的偏移开始读取");
+    }
+
+    bool rejected = false;
+    try {
+        co_async::DirectFileBuf buf(co_await co_async::open_direct_file(pool, kDirectPath), 100);
+    } catch (std::invalid_argument const&) {
+        rejected = true;
+    }
+    check(rejected, "不对齐的起始偏移被拒绝");
+
+    {
+        // 流缓冲区之外的不对齐数据：整块部分分批复制到中转缓冲区写出
+        co_async::DirectFileBuf buf(
+            co_await co_async::open_direct_file(pool, kDirectPath, O_WRONLY | O_CREAT | O_TRUNC));
+        std::string_view unaligned = std::string_view(expect).substr(1, 150000);
+        bool misaligned = !co_async::isDirectAligned(unaligned.data());
+        auto n = co_await buf.write(std::span<char const>(unaligned.data(), unaligned.size()));
+        check(misaligned && n == unaligned.size() && read_whole(kDirectPath) == unaligned,
+              "不对齐的数据经由中转缓冲区写出");
+    }
+    unlink(kDirectPath);
+}
+
+// ---- 帧编解码 ----
+
+template <std::unsigned_integral T>
+bool varint_round_trip(T value, std::size_t expectLen) {
+    char buf[co_async::kMaxVarintSize<T>];
+    std::size_t len = co_async::encodeVarint(buf, value);
+    auto [decoded, used] = co_async::decodeVarint<T>(std::span<char const>(buf, len));
+    return len == expectLen && used == len && decoded == value;
+}
+
+// 解码 bytes，返回 "ok:值"、"incomplete" 或 "overflow"
+template <std::unsigned_integral T>
+std::string decode_result(std::string_view bytes) {
+    try {
+        auto [value, len] = co_async::decodeVarint<T>(std::span<char const>(bytes.data(), bytes.size()));
+        return len ? "ok:" + std::to_string(value) : "incomplete";
+    } catch (std::out_of_range const&) {
+        return "overflow";
+    }
+}
+
+// 一个字节一个字节地送出 varint，读端每次只能看到一部分
+co_async::Task<> varint_writer(co_async::PipeStream& out, std::string bytes) {
+    for (char c : bytes) {
+        co_await out.putchar(c);
+        co_await out.flush();
+    }
+}
+
+co_async::Task<> varint_reader(co_async::PipeStream& in, std::uint64_t expect) {
+    auto value = co_await co_async::read_varint<std::uint64_t>(in);
+    check(value == expect, "read_varint 等到被拆开送达的 varint 完整后再解码");
+}
+
+co_async::FrameFormat frame_format(co_async::FramePrefix prefix, bool checksum) {
+    co_async::FrameFormat format;
+    format.mPrefix = prefix;
+    format.mChecksum = checksum;
+    return format;
+}
+
+constexpr std::size_t kFrameSizes[] = {0, 1, 8000, 100000, 300};
+
+co_async::Task<> frame_writer(co_async::PipeStream& out) {
+    for (auto prefix : {co_async::FramePrefix::Varint, co_async::FramePrefix::Fixed32}) {
+        for (bool checksum : {false, true}) {
+            for (std::size_t size : kFrameSizes) {
+                auto payload = pattern(size);
+                co_await co_async::write_frame(out, std::span<char const>(payload), frame_format(prefix, checksum));
+            }
+        }
+    }
+    // Fixed16 前缀装不下的长度在写端就被拒绝
+    bool rejected = false;
+    try {
+        auto payload = pattern(70000);
+        co_await co_async::write_frame(out, std::span<char const>(payload),
+                                       frame_format(co_async::FramePrefix::Fixed16, false));
+    } catch (std::length_error const&) {
+        rejected = true;
+    }
+    check(rejected, "超出 16 位长度前缀的帧在写端被拒绝");
+    // 校验和被篡改的帧，后面跟一个正常的帧
+    co_async::StringOStream corrupt;
+    auto payload = pattern(50);
+    co_await co_async::write_frame(corrupt, std::span<char const>(payload), frame_format(co_async::FramePrefix::Varint, true));
+    co_await corrupt.flush();
+    corrupt.mString.back() ^= 1;
+    co_await out.puts(corrupt.mString);
+    co_await co_async::write_frame(out, std::span<char const>(payload), frame_format(co_async::FramePrefix::Varint, true));
+    co_await out.flush();
+    out.close();
+}
+
+co_async::Task<> frame_reader(co_async::PipeStream& in) {
+    bool framesOk = true;
+    for (auto prefix : {co_async::FramePrefix::Varint, co_async::FramePrefix::Fixed32}) {
+        for (bool checksum : {false, true}) {
+            co_async::FrameReader reader(in, frame_format(prefix, checksum));
+            for (std::size_t size : kFrameSizes) {
+                auto frame = co_await reader.read_frame();
+                framesOk &= std::string_view(frame.data(), frame.size()) == pattern(size);
+            }
+        }
+    }
+    check(framesOk, "各种前缀、有无校验和、大于缓冲区的帧都能正确读回");
+    co_async::FrameReader reader(in, frame_format(co_async::FramePrefix::Varint, true));
+    bool mismatch = false;
+    try {
+        (void)co_await reader.read_frame();
+    } catch (std::runtime_error const&) {
+        mismatch = true;
+    }
+    auto next = co_await reader.read_frame();
+    check(mismatch && std::string_view(next.data(), next.size()) == pattern(50), "校验和不符的帧报错并被跳过，之后的帧正常读取");
+    bool eof = false;
+    try {
+        (void)co_await reader.read_frame();
+    } catch (co_async::EOFException const&) {
+        eof = true;
+    }
+    check(eof, "帧读完后为 EOF");
+}
+
+co_async::Task<> check_framing() {
+    constexpr auto u64max = std::numeric_limits<std::uint64_t>::max();
+    constexpr auto u32max = std::numeric_limits<std::uint32_t>::max();
+    check(varint_round_trip<std::uint64_t>(0, 1) && varint_round_trip<std::uint64_t>(127, 1) &&
+              varint_round_trip<std::uint64_t>(128, 2) && varint_round_trip<std::uint64_t>(16383, 2) &&
+              varint_round_trip<std::uint64_t>(16384, 3) && varint_round_trip<std::uint64_t>(u64max, 10) &&
+              varint_round_trip<std::uint32_t>(u32max, 5) && varint_round_trip<std::uint8_t>(255, 2),
+          "varint 编解码边界值往返一致");
+
+    // 最后一个字节只剩 64 - 63 = 1 位（uint32_t 为 32 - 28 = 4 位）可用
+    auto full64 = "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01"s;
+    auto over64 = "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x02"s;
+    auto long64 = "\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x00"s;
+    check(decode_result<std::uint64_t>(full64) == "ok:" + std::to_string(u64max) &&
+              decode_result<std::uint64_t>(over64) == "overflow" && decode_result<std::uint64_t>(long64) == "overflow",
+          "decodeVarint<uint64_t> 接受最大值，拒绝超出范围和超过 10 字节的编码");
+    check(decode_result<std::uint32_t>("\xFF\xFF\xFF\xFF\x0F"sv) == "ok:" + std::to_string(u32max) &&
+              decode_result<std::uint32_t>("\xFF\xFF\xFF\xFF\x10"sv) == "overflow" &&
+              decode_result<std::uint8_t>("\xFF\x02"sv) == "overflow",
+          "decodeVarint 对较窄的类型按其位宽检查溢出");
+    check(decode_result<std::uint64_t>("\x80\x80"sv) == "incomplete" && decode_result<std::uint64_t>(""sv) == "incomplete",
+          "不完整的 varint 返回长度 0");
+
+    co_async::StringOStream fixedOut;
+    co_await co_async::write_fixed(fixedOut, std::uint32_t(0x01020304), std::endian::big);
+    co_await co_async::write_fixed(fixedOut, std::int16_t(-2), std::endian::little);
+    co_await fixedOut.flush();
+    co_async::StringIStream fixedIn(fixedOut.mString);
+    auto big = co_await co_async::read_fixed<std::uint32_t>(fixedIn, std::endian::big);
+    auto little = co_await co_async::read_fixed<std::int16_t>(fixedIn, std::endian::little);
+    check(fixedOut.mString == "\x01\x02\x03\x04\xFE\xFF"sv && big == 0x01020304 && little == -2,
+          "定长整数按指定字节序读写");
+
+    co_async::StringIStream overflowIn(over64);
+    bool overflow = false;
+    try {
+        (void)co_await co_async::read_varint<std::uint64_t>(overflowIn);
+    } catch (std::out_of_range const&) {
+        overflow = true;
+    }
+    check(overflow, "read_varint 遇到超出范围的编码抛出 out_of_range");
+
+    auto [a, b] = co_async::make_pipe(loop);
+    co_async::PipeStream varintOut(std::move(a)), varintIn(std::move(b));
+    char encoded[co_async::kMaxVarintSize<std::uint64_t>];
+    std::size_t len = co_async::encodeVarint<std::uint64_t>(encoded, 0x123456789ABCDEF);
+    co_await co_async::when_all(varint_writer(varintOut, std::string(encoded, len)), varint_reader(varintIn, 0x123456789ABCDEF));
+
+    auto [c, d] = co_async::make_pipe(loop);
+    co_async::PipeStream frameOut(std::move(c)), frameIn(std::move(d));
+    co_await co_async::when_all(frame_writer(frameOut), frame_reader(frameIn));
+
+    // 读端声明的长度超过上限时视为格式错误
+    co_async::StringOStream hugeOut;
+    co_await co_async::write_varint(hugeOut, std::uint64_t(1) << 40);
+    co_await hugeOut.flush();
+    co_async::StringIStream hugeIn(hugeOut.mString);
+    co_async::FrameReader hugeReader(hugeIn);
+    bool tooLarge = false;
+    try {
+        (void)co_await hugeReader.read_frame();
+    } catch (std::length_error const&) {
+        tooLarge = true;
+    }
+    check(tooLarge, "长度超过 mMaxSize 的帧被拒绝");
+}
+
+// ---- 输出流的写出错误 ----
+
+// 前 allowed 次写出成功，之后每次都像对端已关闭一样失败；记录写出被调用的次数
+struct FailingWriteBuf {
+    std::size_t mAllowed = 0;
+    std::size_t mWrites = 0;
+
+    FailingWriteBuf() noexcept {}
+    explicit FailingWriteBuf(std::size_t allowed) noexcept : mAllowed(allowed) {}
+
+    co_async::Task<std::size_t> write(std::span<char const> buffer) {
+        if (mWrites++ >= mAllowed) {
+            throw std::system_error(EPIPE, std::system_category(), "write");
+        }
+        co_return buffer.size();
+    }
+};
+
+// 返回 op 是否抛出了 EPIPE
+template <class Op>
+co_async::Task<bool> throws_epipe(Op op) {
+    try {
+        co_await op();
+    } catch (std::system_error const& e) {
+        co_return e.code().value() == EPIPE;
+    }
+    co_return false;
+}
+
+co_async::Task<> check_write_errors() {
+    // 无界模式：后台写出失败后丢弃积压，之后的写入直接抛出，不再追加、不再发起新的写出
+    co_async::OStream<FailingWriteBuf> unbounded;
+    unbounded.set_watermarks(0, 100);
+    co_await unbounded.puts(pattern(200));
+    co_await co_async::sleep_for(loop, 1ms);
+    bool putsThrows = co_await throws_epipe([&] { return unbounded.puts("more"); });
+    bool putcharThrows = co_await throws_epipe([&] { return unbounded.putchar('x'); });
+    int n = 42; // print 按引用接收参数，Task 延迟执行，参数要活到 co_await 结束
+    bool printThrows = co_await throws_epipe([&] { return unbounded.print("n = ", n); });
+    bool writableThrows = co_await throws_epipe([&] { return unbounded.writable(); });
+    check(putsThrows && putcharThrows && printThrows && writableThrows, "无界模式下后台写出失败后，每次写入都抛出该错误");
+    check(unbounded.buffered() == 0 && unbounded.mWrites == 1, "写出失败后积压被丢弃，不再发起新的写出");
+
+    // 自动 flush 模式：本轮结束时的后台 flush 失败，下一次写入或 flush 抛出该错误，也不再安排新的 flush
+    co_async::OStream<FailingWriteBuf> autoFlush;
+    autoFlush.set_auto_flush(loop);
+    co_await autoFlush.puts("hello\n");
+    co_await co_async::sleep_for(loop, 1ms);
+    bool autoPutsThrows = co_await throws_epipe([&] { return autoFlush.puts("again\n"); });
+    bool autoPrintThrows = co_await throws_epipe([&] { return autoFlush.print("n = ", n); });
+    bool autoFlushThrows = co_await throws_epipe([&] { return autoFlush.flush(); });
+    co_await co_async::sleep_for(loop, 1ms);
+    check(autoPutsThrows && autoPrintThrows && autoFlushThrows && autoFlush.mWrites == 1 && autoFlush.buffered() == 0,
+          "自动 flush 模式下后台写出失败后，写入和 flush 都抛出该错误，不再发起新的写出");
+
+    // 普通模式：flush 失败后流同样不再可用
+    co_async::OStream<FailingWriteBuf> plain(1);
+    co_await plain.puts("first");
+    co_await plain.flush();
+    co_await plain.puts("second");
+    bool firstFails = co_await throws_epipe([&] { return plain.flush(); });
+    bool laterFails = co_await throws_epipe([&] { return plain.puts("third"); });
+    check(firstFails && laterFails && plain.mWrites == 2, "flush 失败后之后的写入抛出同一个错误");
+
+    bool zeroRejected = false;
+    try {
+        (void)co_async::make_pipe(loop, 0);
+    } catch (std::invalid_argument const&) {
+        zeroRejected = true;
+    }
+    check(zeroRejected, "容量为 0 的管道在创建时被拒绝，而不是让读写两端永远等待");
+}
+
+co_async::Task<> amain() {
+    co_await check_shared_fd();
+    check_pool();
+    co_await check_mirrored();
+    co_await check_chain();
+    co_await check_inline();
+    co_await check_numbers();
+    co_await check_adaptive();
+    co_async::OffloadPool pool(loop);
+    co_await check_direct(pool);
+    co_await check_framing();
+    co_await check_write_errors();
+    finished = true;
+}
+
+int main() {
+    run_task(loop, amain());
+    check(finished, "所有检查都执行完毕，没有卡住的协程");
+    std::cout << (failures ? "有检查失败\n" : "全部通过\n");
+    return failures ? 1 : 0;
+}